@@ -0,0 +1,104 @@
+/***********************************************************\
+ * Element-wise reading of large top-level arrays          *
+ *     ___________ _____                                   *
+ *    /  ___|  ___/ __  \                                  *
+ *    \ `--.| |_  `' / /'                                  *
+ *     `--. \  _|   / /                                    *
+ *    /\__/ / |   ./ /___                                  *
+ *    \____/\_|   \_____/                                  *
+ *                                                         *
+ *                                                         *
+ *  Copyright (c) 2014 Florian Oetke                       *
+ *                                                         *
+ *  This file is part of SF2 and distributed under         *
+ *  the MIT License. See LICENSE file for details.         *
+\***********************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <istream>
+#include <iterator>
+
+#include "serializer.hpp"
+#include "formats/json_reader.hpp"
+
+namespace sf2 {
+
+	/*
+	 * Input range over the elements of a top-level JSON array, that deserializes one element at a time:
+	 *   for(auto& record : sf2::json_array_stream<Record>(stream)) ...
+	 * All elements are read into the same object, so only one element is in memory at any time
+	 * and its allocations (e.g. of strings) are reused. Members that are missing from an element
+	 * keep the value of the previous one. The range can only be iterated once.
+	 */
+	template<class T>
+	class Json_array_stream {
+		public:
+			class iterator {
+				public:
+					using iterator_category = std::input_iterator_tag;
+					using value_type        = T;
+					using difference_type   = std::ptrdiff_t;
+					using pointer           = T*;
+					using reference         = T&;
+
+					iterator() = default;
+
+					auto operator*()const -> T& {return _stream->_value;}
+					auto operator->()const -> T* {return &_stream->_value;}
+
+					auto operator++() -> iterator& {
+						if(!_stream->_next())
+							_stream = nullptr;
+						return *this;
+					}
+					void operator++(int) {
+						++*this;
+					}
+
+					bool operator==(const iterator& rhs)const noexcept {return _stream==rhs._stream;}
+					bool operator!=(const iterator& rhs)const noexcept {return _stream!=rhs._stream;}
+
+				private:
+					friend class Json_array_stream;
+
+					Json_array_stream* _stream = nullptr;
+
+					explicit iterator(Json_array_stream* stream) : _stream(stream) {}
+			};
+
+			explicit Json_array_stream(std::istream& stream, format::Error_handler ehandler=format::Error_handler{})
+			    : _deserializer(format::Json_reader{stream, ehandler}, ehandler) {}
+
+			auto begin() -> iterator {
+				if(!_started) {
+					_started = true;
+					_has_value = _next();
+				}
+
+				return _has_value ? iterator{this} : end();
+			}
+			auto end() -> iterator {return {};}
+
+		private:
+			Deserializer<format::Json_reader> _deserializer;
+			T    _value{};
+			bool _started = false;
+			bool _has_value = false;
+
+			bool _next() {
+				_has_value = _deserializer.reader.in_array();
+				if(_has_value)
+					_deserializer.read_value(_value);
+
+				return _has_value;
+			}
+	};
+
+	template<class T>
+	auto json_array_stream(std::istream& stream, format::Error_handler ehandler=format::Error_handler{}) {
+		return Json_array_stream<T>{stream, std::move(ehandler)};
+	}
+
+}
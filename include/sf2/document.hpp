@@ -0,0 +1,494 @@
+/***********************************************************\
+ * Lazily navigable JSON document                          *
+ *     ___________ _____                                   *
+ *    /  ___|  ___/ __  \                                  *
+ *    \ `--.| |_  `' / /'                                  *
+ *     `--. \  _|   / /                                    *
+ *    /\__/ / |   ./ /___                                  *
+ *    \____/\_|   \_____/                                  *
+ *                                                         *
+ *                                                         *
+ *  Copyright (c) 2014 Florian Oetke                       *
+ *                                                         *
+ *  This file is part of SF2 and distributed under         *
+ *  the MIT License. See LICENSE file for details.         *
+\***********************************************************/
+
+#pragma once
+
+#include <cctype>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "serializer.hpp"
+#include "formats/json_index.hpp"
+#include "formats/json_reader.hpp"
+#include "formats/simd.hpp"
+
+namespace sf2 {
+
+	enum class Node_type : std::uint8_t {
+		missing, null, boolean, number, string, object, array
+	};
+
+	/*
+	 * A JSON document that is tokenized once into a flat tape of nodes, which reference the
+	 * original text by offset. Values are only deserialized when they are accessed, e.g.
+	 *   doc["players"][3]["name"].get(name);
+	 * The document references the buffer, so the buffer has to outlive the document and all its values.
+	 */
+	class Document {
+		public:
+			class Value;
+
+			Document() = default;
+			explicit Document(std::string_view json, format::Error_handler ehandler=format::Error_handler{});
+
+			auto valid()const noexcept {return !_tape.empty();}
+			auto root()const noexcept -> Value;
+
+			auto operator[](std::string_view key)const -> Value;
+			auto operator[](std::size_t index)const -> Value;
+
+		private:
+			// containers store the index of the first node after their last child in next
+			struct Node {
+				Node_type     type;
+				std::uint32_t begin;
+				std::uint32_t end;
+				std::uint32_t next;
+			};
+
+			// the token that may follow inside an open object or array
+			enum class Expect : std::uint8_t {
+				first_or_end, key, colon, value, comma_or_end
+			};
+			struct Open {
+				std::uint32_t node;
+				Expect        expect;
+			};
+
+			std::string_view     _json;
+			std::vector<Node>    _tape;
+			format::Error_handler _error_handler;
+
+			void _parse();
+			void _parse_indexed(const format::Structural_index& index);
+			auto _push(Node_type type, std::uint32_t begin, std::uint32_t end) -> std::uint32_t;
+			auto _scalar_end(std::uint32_t begin)const -> std::uint32_t;
+			auto _position(std::uint32_t offset)const -> std::pair<std::uint32_t, std::uint32_t>;
+			bool _accept(std::vector<Open>& open, char c, std::uint32_t offset);
+			void _open(std::vector<Open>& open, Node_type type, std::uint32_t offset);
+			bool _close(std::vector<Open>& open, char c, std::uint32_t offset);
+			void _on_error(const std::string& e, std::uint32_t offset);
+			bool _key_equals(const Node& key, std::string_view expected)const;
+	};
+
+	class Document::Value {
+		public:
+			Value() = default;
+
+			auto type()const noexcept {return _doc ? _node().type : Node_type::missing;}
+			explicit operator bool()const noexcept {return type()!=Node_type::missing;}
+
+			// the unparsed JSON text of the value
+			auto raw()const noexcept -> std::string_view;
+
+			// number of members of an object or elements of an array, 0 for everything else
+			auto size()const -> std::size_t;
+
+			// missing values are returned for non-objects/-arrays and unknown keys/indices
+			auto operator[](std::string_view key)const -> Value;
+			auto operator[](std::size_t index)const -> Value;
+
+			// deserializes the value with the normal Deserializer, returns false if it is missing.
+			// The reported row/column are relative to the complete document
+			template<class T>
+			bool get(T& out, format::Error_handler ehandler=format::Error_handler{})const;
+
+			template<class T>
+			auto as()const -> T {
+				auto v = T();
+				get(v);
+				return v;
+			}
+
+		private:
+			friend class Document;
+
+			const Document* _doc = nullptr;
+			std::uint32_t   _index = 0;
+
+			Value(const Document* doc, std::uint32_t index) : _doc(doc), _index(index) {}
+
+			auto _node()const noexcept -> const Node& {return _doc->_tape[_index];}
+	};
+
+
+	inline Document::Document(std::string_view json, format::Error_handler ehandler)
+	    : _json(json), _error_handler(std::move(ehandler)) {
+
+		if(json.size() >= std::numeric_limits<std::uint32_t>::max()) {
+			_on_error("Document too large", 0);
+			return;
+		}
+
+		_tape.reserve(json.size() / 8);
+
+		// the structural index is only used to jump between tokens, which doesn't work for comments
+		auto index = format::Structural_index{json};
+		if(index.valid())
+			_parse_indexed(index);
+		else
+			_parse();
+	}
+
+	inline auto Document::root()const noexcept -> Value {
+		return _tape.empty() ? Value{} : Value{this, 0};
+	}
+	inline auto Document::operator[](std::string_view key)const -> Value {
+		return root()[key];
+	}
+	inline auto Document::operator[](std::size_t index)const -> Value {
+		return root()[index];
+	}
+
+	inline auto Document::_push(Node_type type, std::uint32_t begin, std::uint32_t end) -> std::uint32_t {
+		auto index = static_cast<std::uint32_t>(_tape.size());
+		_tape.push_back(Node{type, begin, end, index+1});
+		return index;
+	}
+	inline auto Document::_scalar_end(std::uint32_t begin)const -> std::uint32_t {
+		auto end = begin;
+		for(; end<_json.size(); end++) {
+			auto c = _json[end];
+			if(c==',' || c=='}' || c==']' || c==':' || c=='/' || !std::isgraph(static_cast<unsigned char>(c)))
+				break;
+		}
+		return end;
+	}
+	// checks that the token starting with c may follow the previous one, i.e. that objects consist of
+	// key-value pairs and that values are separated by commas
+	inline bool Document::_accept(std::vector<Open>& open, char c, std::uint32_t offset) {
+		auto valid = false;
+
+		if(open.empty()) {
+			valid = c!=',' && c!=':' && c!='}' && c!=']';
+
+		} else {
+			auto& top = open.back();
+			auto object = _tape[top.node].type==Node_type::object;
+
+			switch(c) {
+				case ':':
+					valid = top.expect==Expect::colon;
+					top.expect = Expect::value;
+					break;
+				case ',':
+					valid = top.expect==Expect::comma_or_end;
+					top.expect = object ? Expect::key : Expect::value;
+					break;
+				case '}':
+				case ']':
+					valid = top.expect==Expect::comma_or_end || top.expect==Expect::first_or_end;
+					break;
+				default:
+					if(object && (top.expect==Expect::key || top.expect==Expect::first_or_end)) {
+						valid = c=='"';
+						top.expect = Expect::colon;
+					} else {
+						valid = top.expect==Expect::value || top.expect==Expect::first_or_end;
+						top.expect = Expect::comma_or_end;
+					}
+					break;
+			}
+		}
+
+		if(!valid)
+			_on_error(std::string("Unexpected character ")+c, offset);
+
+		return valid;
+	}
+	inline void Document::_open(std::vector<Open>& open, Node_type type, std::uint32_t offset) {
+		open.push_back(Open{_push(type, offset, offset), Expect::first_or_end});
+	}
+	inline bool Document::_close(std::vector<Open>& open, char c, std::uint32_t offset) {
+		auto expected = c=='}' ? Node_type::object : Node_type::array;
+		if(open.empty() || _tape[open.back().node].type!=expected) {
+			_on_error(std::string("Unexpected character ")+c, offset);
+			return false;
+		}
+
+		auto& node = _tape[open.back().node];
+		node.end  = offset + 1;
+		node.next = static_cast<std::uint32_t>(_tape.size());
+		open.pop_back();
+		return true;
+	}
+
+	inline void Document::_parse_indexed(const format::Structural_index& index) {
+		auto open = std::vector<Open>();
+		auto& positions = index.positions();
+
+		for(auto i=std::size_t(0); i<positions.size(); i++) {
+			auto offset = positions[i];
+			auto c = _json[offset];
+
+			if(!_accept(open, c, offset))
+				return;
+
+			switch(c) {
+				case '{':
+					_open(open, Node_type::object, offset);
+					break;
+				case '[':
+					_open(open, Node_type::array, offset);
+					break;
+				case '}':
+				case ']':
+					if(!_close(open, c, offset))
+						return;
+					break;
+				case ',':
+				case ':':
+					break;
+				case '"':
+					// the closing quote is always the next position in a valid index
+					_push(Node_type::string, offset, positions[++i]+1);
+					break;
+				default: {
+					auto type = c=='n' ? Node_type::null : c=='t' || c=='f' ? Node_type::boolean : Node_type::number;
+					_push(type, offset, _scalar_end(offset));
+					break;
+				}
+			}
+
+			if(open.empty() && !_tape.empty())
+				return; // ignore everything after the top-level value
+		}
+
+		if(!open.empty() || _tape.empty())
+			_on_error("Unexpected end of file", static_cast<std::uint32_t>(_json.size()));
+	}
+
+	inline void Document::_parse() {
+		auto open = std::vector<Open>();
+		auto begin = _json.data();
+		auto end = _json.data() + _json.size();
+
+		for(auto pos=begin; pos!=end;) {
+			auto offset = static_cast<std::uint32_t>(pos-begin);
+			auto c = *pos;
+
+			switch(c) {
+				case ' ':
+				case '\t':
+				case '\r':
+				case '\n':
+					pos++;
+					continue;
+
+				case ',':
+				case ':':
+					if(!_accept(open, c, offset))
+						return;
+					pos++;
+					continue;
+
+				case '/': {
+					if(pos+1==end || pos[1]!='*') {
+						_on_error("Unexpected character /", offset);
+						return;
+					}
+					auto comment_end = _json.find("*/", offset+2);
+					if(comment_end==std::string_view::npos) {
+						_on_error("Unexpected end of file in comment", static_cast<std::uint32_t>(_json.size()));
+						return;
+					}
+					pos = begin + comment_end + 2;
+					continue;
+				}
+
+				default:
+					break;
+			}
+
+			// everything else is the start or end of a value
+			if(!_accept(open, c, offset))
+				return;
+
+			switch(c) {
+				case '{':
+					_open(open, Node_type::object, offset);
+					pos++;
+					break;
+				case '[':
+					_open(open, Node_type::array, offset);
+					pos++;
+					break;
+				case '}':
+				case ']':
+					if(!_close(open, c, offset))
+						return;
+					pos++;
+					break;
+
+				case '"': {
+					auto str_end = pos+1;
+					for(;;) {
+						str_end = format::details::find_string_special(str_end, end);
+						if(str_end==end) {
+							_on_error("Unexpected end of file in string", static_cast<std::uint32_t>(_json.size()));
+							return;
+						}
+						if(*str_end=='"')
+							break;
+						str_end += *str_end=='\\' && str_end+1!=end ? 2 : 1;
+					}
+					pos = str_end+1;
+					_push(Node_type::string, offset, static_cast<std::uint32_t>(pos-begin));
+					break;
+				}
+
+				default: {
+					auto type = c=='n' ? Node_type::null : c=='t' || c=='f' ? Node_type::boolean : Node_type::number;
+					auto scalar_end = _scalar_end(offset);
+					_push(type, offset, scalar_end);
+					pos = begin + scalar_end;
+					break;
+				}
+			}
+
+			if(open.empty())
+				return; // ignore everything after the top-level value
+		}
+
+		_on_error("Unexpected end of file", static_cast<std::uint32_t>(_json.size()));
+	}
+
+	inline auto Document::_position(std::uint32_t offset)const -> std::pair<std::uint32_t, std::uint32_t> {
+		auto row = std::uint32_t(1);
+		auto line_begin = std::size_t(0);
+		for(auto i=std::size_t(0); i<offset && i<_json.size(); i++) {
+			if(_json[i]=='\n') {
+				row++;
+				line_begin = i+1;
+			}
+		}
+		return {row, static_cast<std::uint32_t>(offset - line_begin + 1)};
+	}
+
+	inline void Document::_on_error(const std::string& e, std::uint32_t offset) {
+		_tape.clear();
+
+		auto [row, column] = _position(offset);
+		if(_error_handler) {
+			_error_handler(e, row, column);
+
+		} else {
+			std::cerr<<"Error parsing JSON at "<<row<<":"<<column<<" : "<<e<<std::endl;
+			abort();
+		}
+	}
+
+	// escape sequences are decoded the same way as by Json_reader, which makes them always shorter than the input
+	inline bool Document::_key_equals(const Node& key, std::string_view expected)const {
+		auto str = _json.substr(key.begin+1, key.end-key.begin-2);
+		if(str.size()==expected.size() && str==expected)
+			return true;
+		if(str.size()<=expected.size() || str.find('\\')==std::string_view::npos)
+			return false;
+
+		auto e = std::size_t(0);
+		for(auto i=std::size_t(0); i<str.size(); i++) {
+			char decoded[4] = {str[i]};
+			auto length = std::size_t(1);
+			if(str[i]=='\\')
+				length = format::details::decode_escape([&] {return ++i<str.size() ? str[i] : '\0';}, decoded);
+
+			if(length==0 || expected.size()-e<length || expected.compare(e, length, decoded, length)!=0)
+				return false;
+			e += length;
+		}
+		return e==expected.size();
+	}
+
+
+	inline auto Document::Value::raw()const noexcept -> std::string_view {
+		if(!_doc)
+			return {};
+
+		auto& node = _node();
+		return _doc->_json.substr(node.begin, node.end-node.begin);
+	}
+
+	inline auto Document::Value::size()const -> std::size_t {
+		auto t = type();
+		if(t!=Node_type::object && t!=Node_type::array)
+			return 0;
+
+		auto& tape = _doc->_tape;
+		auto count = std::size_t(0);
+		for(auto i=_index+1; i<_node().next; i=tape[i].next)
+			count++;
+
+		return t==Node_type::object ? count/2 : count;
+	}
+
+	inline auto Document::Value::operator[](std::string_view key)const -> Value {
+		if(type()!=Node_type::object)
+			return {};
+
+		auto& tape = _doc->_tape;
+		auto end = _node().next;
+		for(auto i=_index+1; i<end;) {
+			auto value = tape[i].next;
+			if(value>=end)
+				break; // key without value, only possible in documents that failed to parse
+
+			if(_doc->_key_equals(tape[i], key))
+				return {_doc, value};
+
+			i = tape[value].next;
+		}
+
+		return {};
+	}
+	inline auto Document::Value::operator[](std::size_t index)const -> Value {
+		if(type()!=Node_type::array)
+			return {};
+
+		auto& tape = _doc->_tape;
+		for(auto i=_index+1; i<_node().next; i=tape[i].next) {
+			if(index--==0)
+				return {_doc, i};
+		}
+
+		return {};
+	}
+
+	template<class T>
+	bool Document::Value::get(T& out, format::Error_handler ehandler)const {
+		if(!*this)
+			return false;
+
+		auto failed = false;
+		auto handler = format::Error_handler{};
+		if(ehandler) {
+			auto [base_row, base_column] = _doc->_position(_node().begin);
+			handler = [&, base_row=base_row, base_column=base_column](auto& msg, std::uint32_t row, std::uint32_t column) {
+				failed = true;
+				ehandler(msg, base_row+row-1, row==1 ? base_column+column-1 : column);
+			};
+		}
+
+		Deserializer<format::Json_reader>{format::Json_reader{raw(), handler}, handler}.read_value(out);
+		return !failed;
+	}
+
+}
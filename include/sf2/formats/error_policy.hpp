@@ -0,0 +1,114 @@
+/***********************************************************\
+ * Error handling policies of the readers                  *
+ *     ___________ _____                                   *
+ *    /  ___|  ___/ __  \                                  *
+ *    \ `--.| |_  `' / /'                                  *
+ *     `--. \  _|   / /                                    *
+ *    /\__/ / |   ./ /___                                  *
+ *    \____/\_|   \_____/                                  *
+ *                                                         *
+ *                                                         *
+ *  Copyright (c) 2014 Florian Oetke                       *
+ *                                                         *
+ *  This file is part of SF2 and distributed under         *
+ *  the MIT License. See LICENSE file for details.         *
+\***********************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+namespace sf2 {
+namespace format {
+
+	using Error_handler = std::function<void (const std::string& msg, uint32_t row, uint32_t column)>;
+
+	/*
+	 * A reader calls its policy once for the first error, with a function that creates the message,
+	 * so the message is only built if the policy needs it:
+	 *   void operator()(const Message& msg, uint32_t row, uint32_t column);  // msg() -> std::string
+	 * If the policy returns, the reader stops and all further reads fail silently.
+	 */
+
+	// prints the error and aborts
+	struct Abort_on_error {
+		template<class Message>
+		[[noreturn]] void operator()(const Message& msg, uint32_t row, uint32_t column) {
+			std::cerr<<"Error parsing JSON at "<<row<<":"<<column<<" : "<<msg()<<std::endl;
+			std::abort();
+		}
+	};
+
+	// calls the Error_handler or aborts if there is none
+	class Error_callback {
+		public:
+			Error_callback() = default;
+			template<class F, class = std::enable_if_t<std::is_constructible<Error_handler, F&&>::value
+			                                           && !std::is_same<std::decay_t<F>, Error_callback>::value>>
+			Error_callback(F&& handler) : _handler(std::forward<F>(handler)) {}
+
+			template<class Message>
+			void operator()(const Message& msg, uint32_t row, uint32_t column) {
+				if(_handler)
+					_handler(msg(), row, column);
+				else
+					Abort_on_error{}(msg, row, column);
+			}
+
+		private:
+			Error_handler _handler;
+	};
+
+	class Parse_error : public std::runtime_error {
+		public:
+			Parse_error(const std::string& msg, uint32_t row, uint32_t column)
+			    : std::runtime_error(msg), _row(row), _column(column) {}
+
+			auto row()const noexcept {return _row;}
+			auto column()const noexcept {return _column;}
+
+		private:
+			uint32_t _row;
+			uint32_t _column;
+	};
+
+	// throws a Parse_error
+	struct Throw_on_error {
+		template<class Message>
+		[[noreturn]] void operator()(const Message& msg, uint32_t row, uint32_t column) {
+			throw Parse_error(msg(), row, column);
+		}
+	};
+
+	// remembers the error, so it can be checked after parsing
+	class Store_error {
+		public:
+			template<class Message>
+			void operator()(const Message& msg, uint32_t row, uint32_t column) {
+				_failed = true;
+				_message = msg();
+				_row = row;
+				_column = column;
+			}
+
+			auto failed()const noexcept {return _failed;}
+			auto& message()const noexcept {return _message;}
+			auto row()const noexcept {return _row;}
+			auto column()const noexcept {return _column;}
+
+		private:
+			bool        _failed = false;
+			std::string _message;
+			uint32_t    _row = 0;
+			uint32_t    _column = 0;
+	};
+
+}
+}
@@ -0,0 +1,237 @@
+/***********************************************************\
+ * Structural index of a JSON document (stage 1)           *
+ *     ___________ _____                                   *
+ *    /  ___|  ___/ __  \                                  *
+ *    \ `--.| |_  `' / /'                                  *
+ *     `--. \  _|   / /                                    *
+ *    /\__/ / |   ./ /___                                  *
+ *    \____/\_|   \_____/                                  *
+ *                                                         *
+ *                                                         *
+ *  Copyright (c) 2014 Florian Oetke                       *
+ *                                                         *
+ *  This file is part of SF2 and distributed under         *
+ *  the MIT License. See LICENSE file for details.         *
+\***********************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string_view>
+#include <vector>
+
+#include "simd.hpp"
+
+namespace sf2 {
+namespace format {
+
+	namespace details {
+		// bit i of the result is the xor of the bits 0..i of v
+		inline auto prefix_xor(std::uint64_t v) noexcept -> std::uint64_t {
+			v ^= v << 1;
+			v ^= v << 2;
+			v ^= v << 4;
+			v ^= v << 8;
+			v ^= v << 16;
+			v ^= v << 32;
+			return v;
+		}
+
+		// one bit per byte of a 64 byte block
+		struct Block_masks {
+			std::uint64_t quote;
+			std::uint64_t backslash;
+			std::uint64_t structural; // {}[]:,
+			std::uint64_t whitespace;
+			std::uint64_t newline;
+			std::uint64_t slash;
+		};
+
+#if defined(__AVX2__)
+		inline auto classify_block(const char* in) noexcept -> Block_masks {
+			__m256i v[2] = {
+			    _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in)),
+			    _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in+32))
+			};
+			auto eq = [&](const __m256i* vs, char c) {
+				auto cv = _mm256_set1_epi8(c);
+				auto lo = static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(vs[0], cv)));
+				auto hi = static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(vs[1], cv)));
+				return std::uint64_t(lo) | (std::uint64_t(hi) << 32);
+			};
+			// '['|0x20 == '{' and ']'|0x20 == '}'
+			__m256i lower[2] = {
+			    _mm256_or_si256(v[0], _mm256_set1_epi8(0x20)),
+			    _mm256_or_si256(v[1], _mm256_set1_epi8(0x20))
+			};
+
+			auto m = Block_masks{};
+			m.quote      = eq(v, '"');
+			m.backslash  = eq(v, '\\');
+			m.structural = eq(lower, '{') | eq(lower, '}') | eq(v, ':') | eq(v, ',');
+			m.newline    = eq(v, '\n');
+			m.whitespace = eq(v, ' ') | eq(v, '\t') | eq(v, '\r') | m.newline;
+			m.slash      = eq(v, '/');
+			return m;
+		}
+
+#elif defined(SF2_SSE2)
+		inline auto classify_block(const char* in) noexcept -> Block_masks {
+			__m128i v[4];
+			__m128i lower[4];
+			for(int i=0; i<4; i++) {
+				v[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i*16));
+				// '['|0x20 == '{' and ']'|0x20 == '}'
+				lower[i] = _mm_or_si128(v[i], _mm_set1_epi8(0x20));
+			}
+			auto eq = [&](const __m128i* vs, char c) {
+				auto cv = _mm_set1_epi8(c);
+				auto r = std::uint64_t(0);
+				for(int i=0; i<4; i++) {
+					auto bits = static_cast<std::uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(vs[i], cv)));
+					r |= std::uint64_t(bits) << (i*16);
+				}
+				return r;
+			};
+
+			auto m = Block_masks{};
+			m.quote      = eq(v, '"');
+			m.backslash  = eq(v, '\\');
+			m.structural = eq(lower, '{') | eq(lower, '}') | eq(v, ':') | eq(v, ',');
+			m.newline    = eq(v, '\n');
+			m.whitespace = eq(v, ' ') | eq(v, '\t') | eq(v, '\r') | m.newline;
+			m.slash      = eq(v, '/');
+			return m;
+		}
+
+#else
+		inline auto classify_block(const char* in) noexcept -> Block_masks {
+			auto m = Block_masks{};
+			for(int i=0; i<64; i++) {
+				auto bit = std::uint64_t(1) << i;
+				switch(in[i]) {
+					case '"':  m.quote |= bit; break;
+					case '\\': m.backslash |= bit; break;
+					case '/':  m.slash |= bit; break;
+					case '{': case '}': case '[': case ']': case ':': case ',':
+						m.structural |= bit;
+						break;
+					case '\n':
+						m.newline |= bit;
+						m.whitespace |= bit;
+						break;
+					case ' ': case '\t': case '\r':
+						m.whitespace |= bit;
+						break;
+					default:
+						break;
+				}
+			}
+			return m;
+		}
+#endif
+
+		// marks all characters that are escaped by an odd number of preceding backslashes
+		inline auto find_escaped(std::uint64_t backslash, std::uint64_t& prev_escaped) noexcept -> std::uint64_t {
+			if(backslash==0) {
+				auto escaped = prev_escaped;
+				prev_escaped = 0;
+				return escaped;
+			}
+
+			constexpr auto even_bits = std::uint64_t(0x5555555555555555ULL);
+
+			backslash &= ~prev_escaped;
+			auto follows_escape = backslash << 1 | prev_escaped;
+			auto odd_sequence_starts = backslash & ~even_bits & ~follows_escape;
+			auto sequences_starting_on_even_bits = odd_sequence_starts + backslash;
+			prev_escaped = sequences_starting_on_even_bits < odd_sequence_starts ? 1 : 0;
+			auto invert_mask = sequences_starting_on_even_bits << 1;
+			return (even_bits ^ invert_mask) & follows_escape;
+		}
+	}
+
+	/*
+	 * Offsets of all tokens in a document: structural characters ({}[]:,) and quotes outside
+	 * of strings and the first character of every other value.
+	 * Newlines are recorded separately to calculate row/column of an offset on demand.
+	 * The index is only valid for documents without comments and with terminated strings,
+	 * everything else has to be handled by the regular character based parser.
+	 */
+	class Structural_index {
+		public:
+			Structural_index() = default;
+			explicit Structural_index(std::string_view document);
+
+			auto valid()const noexcept {return _valid;}
+			auto& positions()const noexcept {return _positions;}
+			auto& newlines()const noexcept {return _newlines;}
+
+		private:
+			std::vector<std::uint32_t> _positions;
+			std::vector<std::uint32_t> _newlines;
+			bool _valid = false;
+
+			static void _flatten(std::vector<std::uint32_t>& out, std::uint32_t base, std::uint64_t bits);
+	};
+
+
+	inline Structural_index::Structural_index(std::string_view document) {
+		if(document.size() >= std::numeric_limits<std::uint32_t>::max())
+			return;
+
+		_positions.reserve(document.size() / 8);
+
+		auto prev_escaped = std::uint64_t(0);
+		auto prev_in_string = std::uint64_t(0);
+		auto prev_scalar = std::uint64_t(0);
+
+		for(std::size_t base=0; base<document.size(); base+=64) {
+			const char* block = document.data() + base;
+
+			char tail[64];
+			if(document.size() - base < 64) {
+				std::memset(tail, ' ', 64);
+				std::memcpy(tail, block, document.size() - base);
+				block = tail;
+			}
+
+			auto m = details::classify_block(block);
+
+			auto escaped = details::find_escaped(m.backslash, prev_escaped);
+			auto quote = m.quote & ~escaped;
+
+			// includes the opening but not the closing quote
+			auto in_string = details::prefix_xor(quote) ^ prev_in_string;
+			prev_in_string = std::uint64_t(static_cast<std::int64_t>(in_string) >> 63);
+
+			if((m.slash & ~in_string) != 0)
+				return; // comments are only handled by the regular parser
+
+			auto scalar = ~(m.structural | m.whitespace | quote) & ~in_string;
+			auto scalar_start = scalar & ~(scalar << 1 | prev_scalar);
+			prev_scalar = scalar >> 63;
+
+			auto offset = static_cast<std::uint32_t>(base);
+			_flatten(_positions, offset, (m.structural & ~in_string) | quote | scalar_start);
+			_flatten(_newlines, offset, m.newline);
+		}
+
+		_valid = prev_in_string==0;
+	}
+
+	inline void Structural_index::_flatten(std::vector<std::uint32_t>& out, std::uint32_t base, std::uint64_t bits) {
+		if(bits==0)
+			return;
+
+		auto i = out.size();
+		out.resize(i + static_cast<std::size_t>(details::popcount(bits)));
+
+		for(; bits!=0; bits &= bits-1)
+			out[i++] = base + static_cast<std::uint32_t>(details::trailing_zeros(bits));
+	}
+
+}
+}
@@ -17,33 +17,190 @@
 #pragma once
 
 #include <cctype>
+#include <clocale>
 #include <string>
+#include <string_view>
 #include <istream>
 #include <vector>
 #include <cassert>
-#include <cmath>
 #include <iostream>
 #include <functional>
 #include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <charconv>
+#include <limits>
+#include <typeinfo>
+#include <type_traits>
+#include <utility>
+
+#include "error_policy.hpp"
+#include "json_index.hpp"
+#include "../string_arena.hpp"
 
 namespace sf2 {
 namespace format {
 
-	using Error_handler = std::function<void (const std::string& msg, uint32_t row, uint32_t column)>;
+	enum class Index_mode {
+		none,
+		structural // build a Structural_index up front and use it to skip whitespace and strings
+	};
+
+	namespace details {
+		template<class Get>
+		int read_hex4(Get& get) {
+			auto value = 0;
+			for(auto i=0; i<4; i++) {
+				auto c = get();
+				auto digit = c>='0' && c<='9' ? c-'0' : c>='a' && c<='f' ? c-'a'+10 : c>='A' && c<='F' ? c-'A'+10 : -1;
+				if(digit<0)
+					return -1;
+				value = value*16 + digit;
+			}
+			return value;
+		}
+
+		/*
+		 * Decodes the escape sequence behind a backslash into up to 4 bytes of UTF-8 and returns their number,
+		 * or 0 if the sequence is invalid. get() returns the next character of the input.
+		 * Escaped characters without a special meaning (e.g. \" or \\) are decoded to themselves.
+		 * The decoded sequence is never longer than the escape sequence, so strings can be decoded in place.
+		 */
+		template<class Get>
+		std::size_t decode_escape(Get&& get, char* out) {
+			auto c = get();
+			switch(c) {
+				case 'n': *out = '\n'; return 1;
+				case 'r': *out = '\r'; return 1;
+				case 't': *out = '\t'; return 1;
+				case 'b': *out = '\b'; return 1;
+				case 'f': *out = '\f'; return 1;
+				case 'u': break;
+				default:  *out = c; return 1;
+			}
+
+			auto code = read_hex4(get);
+			if(code<0 || (code>=0xDC00 && code<=0xDFFF))
+				return 0;
+
+			if(code>=0xD800 && code<=0xDBFF) {
+				// a high surrogate has to be followed by a low one
+				if(get()!='\\' || get()!='u')
+					return 0;
+				auto low = read_hex4(get);
+				if(low<0xDC00 || low>0xDFFF)
+					return 0;
+				code = 0x10000 + ((code-0xD800)<<10) + (low-0xDC00);
+			}
 
-	class Json_reader {
+			if(code<0x80) {
+				out[0] = static_cast<char>(code);
+				return 1;
+			} else if(code<0x800) {
+				out[0] = static_cast<char>(0xC0 | (code>>6));
+				out[1] = static_cast<char>(0x80 | (code & 0x3F));
+				return 2;
+			} else if(code<0x10000) {
+				out[0] = static_cast<char>(0xE0 | (code>>12));
+				out[1] = static_cast<char>(0x80 | ((code>>6) & 0x3F));
+				out[2] = static_cast<char>(0x80 | (code & 0x3F));
+				return 3;
+			} else {
+				out[0] = static_cast<char>(0xF0 | (code>>18));
+				out[1] = static_cast<char>(0x80 | ((code>>12) & 0x3F));
+				out[2] = static_cast<char>(0x80 | ((code>>6) & 0x3F));
+				out[3] = static_cast<char>(0x80 | (code & 0x3F));
+				return 4;
+			}
+		}
+	}
+
+	// selects the destructive reader constructor, that decodes strings inside the input buffer
+	struct In_situ_t {
+		explicit In_situ_t() = default;
+	};
+	constexpr auto in_situ = In_situ_t{};
+
+	/*
+	 * Errors are passed to the Error_policy (see error_policy.hpp). After the first error
+	 * the reader skips to the end of its input, so all further reads fail.
+	 */
+	template<class Error_policy>
+	class Basic_json_reader {
 		public:
-			Json_reader(std::istream& stream, Error_handler ehandler=Error_handler{});
+			// reader for the elements of read_remaining_array_elements, e.g. on other threads.
+			// Its errors are only recorded (through an Error_handler or Store_error) and reported by the caller
+			// through this reader. Policies that can do neither are replaced by Store_error
+			using Slice_reader = std::conditional_t<std::is_constructible<Error_policy, Error_handler>::value
+			                                        || std::is_same<Error_policy, Store_error>::value,
+			                                        Basic_json_reader, Basic_json_reader<Store_error>>;
+
+			// reads the stream through an internal buffer, so it doesn't have to be seekable.
+			// characters that have been read ahead are put back once the top-level value is complete
+			Basic_json_reader(std::istream& stream, Error_policy error_policy=Error_policy{});
+			// reads directly from a contiguous buffer, that has to outlive the reader
+			Basic_json_reader(std::string_view buffer, Error_policy error_policy=Error_policy{},
+			                  Index_mode index_mode=Index_mode::none);
+			// escaped strings read into std::string_view are decoded in place, which overwrites parts of the buffer
+			Basic_json_reader(In_situ_t, char* buffer, std::size_t size, Error_policy error_policy=Error_policy{},
+			                  Index_mode index_mode=Index_mode::none);
+
+			auto& error_policy()noexcept {return _error_policy;}
+			auto& error_policy()const noexcept {return _error_policy;}
+			auto failed()const noexcept {return _error;}
+			// reports an error detected by the caller (e.g. an unexpected key) through the error policy,
+			// at the current position. Like all errors, it stops the reader
+			void on_error(const std::string& msg) {_on_error([&] {return msg;});}
+			// same at the given position, e.g. of an error in a Slice_reader
+			void on_error(const std::string& msg, uint32_t row, uint32_t column) {
+				_on_error_at([&] {return msg;}, row, column);
+			}
 
 			// returns true if the next key is ready to be read
 			bool in_obj();
 			bool in_array();
 
 			void skip_obj();
+			// skips the next value of any type without allocating
+			void skip_value();
+
+			// splits the next array into the text of its elements without parsing them, e.g. to parse
+			// them on multiple threads. Only supported for buffers without String_arena or in situ parsing,
+			// returns false (and consumes nothing) if that's not the case or the next value is no array
+			bool read_array_elements(std::vector<std::string_view>& elements);
+			// same as read_array_elements, but for the remaining elements of the current array, after
+			// in_array() returned true, i.e. some elements have already been read one by one
+			bool read_remaining_array_elements(std::vector<std::string_view>& elements);
+			// reads an array of numbers in a single loop, without the state handling of in_array() and
+			// read() for each element. Only supported for buffers, returns false (and consumes nothing)
+			// if the input is a stream or the next value is no array
+			template<typename T, class Allocator>
+			bool read_numbers(std::vector<T, Allocator>& out);
+			// continues parsing inside an array after one of its elements, i.e. for a reader
+			// over a slice of read_array_elements, whose elements are read with in_array()
+			void continue_array() {_state.push_back(State::array);}
+			// number of elements of the next value, if it's an array whose elements can be counted without
+			// parsing them (i.e. with a structural index). 0 otherwise. Nothing is consumed
+			auto array_size_hint() -> std::size_t {return _size_hint('[');}
+			// same for the number of members of an object
+			auto object_size_hint() -> std::size_t {return _size_hint('{');}
+
+			// positions are only tracked as pointers, row and column are computed on demand
+			// by counting the newlines before them
+			auto position_of(const char* p)const -> std::pair<uint32_t, uint32_t>;
 
 			bool read_nullptr(); // look-ahead if false
 
+			// storage for std::string_view values that can't reference the input directly
+			void string_arena(String_arena* arena) noexcept {_arena = arena;}
+
 			void read(std::string&);
+			// the result references either the input buffer or the String_arena
+			void read(std::string_view&);
+			// reads an object key, that references the input if it contains no escape sequences
+			// and is decoded into buffer otherwise. Only valid until the next read
+			auto read_key(std::string& buffer) -> std::string_view;
 			void read(bool&);
 			void read(float&);
 			void read(double&);
@@ -56,8 +213,8 @@ namespace format {
 			void read(uint64_t&);
 			void read(int64_t&);
 
-			auto row()const noexcept {return _row;}
-			auto column()const noexcept {return _column;}
+			auto row()const noexcept -> uint32_t;
+			auto column()const noexcept -> uint32_t;
 			char peek() {
 				auto c = _next();
 				_unget();
@@ -65,137 +222,380 @@ namespace format {
 			}
 
 		private:
+			bool _refill(std::size_t min_size=1);
+			void _release_stream();
+			int  _underflow();
+			int  _peek_raw();
 			char _get();
 			void _unget();
-			void _mark();
-			void _rewind();
 
 			char _next(bool in_string=false);
+			void _skip_blanks();
+			char _next_indexed();
+			bool _read_indexed(std::string&);
+			void _read_string_body(std::string&);
+			std::string_view _read_string_body_in_situ();
+			bool _skip_nested_indexed();
+			auto _size_hint(char open) -> std::size_t;
+			void _skip_nested();
+			void _split_array(std::vector<std::string_view>& elements);
+			void _skip_string_body();
+			void _skip_comment_body();
 			void _post_read();
 
-			template<typename T>
-			T _read_decimal();
-
 			template<typename T>
 			T _read_int();
 
 			template<typename T>
 			T _read_float();
 
-			void _on_error(const std::string&);
+			template<typename T>
+			static T _strto(std::string& str, std::size_t& length);
+			template<typename T>
+			static T _out_of_range_float(const char* begin, const char* end);
+
+			template<class Message>
+			void _on_error(const Message& msg) {
+				if(!_error) // the position is only computed for the first error
+					_on_error_at(msg, row(), column());
+			}
+			template<class Message>
+			void _on_error_at(const Message&, uint32_t row, uint32_t column);
+			void _on_error(const char* msg) {_on_error([&] {return std::string(msg);});}
 
 			enum class State {
 				obj_key, obj_value, array
 			};
 
-			std::istream& _stream;
-			Error_handler _error_handler;
+			// [_pos, _end) is the remaining input or (if _stream is set) the part of it that is already buffered
+			std::istream* _stream = nullptr;
+			std::vector<char> _stream_buffer;
+			char* _mutable_begin = nullptr; // only set for in situ parsing
+			const char* _begin = nullptr;
+			const char* _pos = nullptr;
+			const char* _end = nullptr;
+			Error_policy _error_policy;
 			bool _error = false;
 			std::vector<State> _state;
-			uint32_t _column = 1;
-			uint32_t _row = 1;
-
-			std::iostream::pos_type _marked_pos;
-			uint32_t _saved_column = 1;
-			uint32_t _saved_row = 1;
+			std::string _number_buffer;
+			std::string _string_buffer;
+			String_arena* _arena = nullptr;
+			Structural_index _index;
+			std::size_t _index_pos = 0;
+			// newlines and length of the last line in the part of the stream that has been discarded
+			uint32_t _discarded_rows = 0;
+			std::size_t _discarded_line_length = 0;
+			// offsets of the newlines in the input, recorded before in situ decoding writes
+			// decoded '\n' escapes into it. Only used if there is no structural index
+			std::vector<std::uint32_t> _original_newlines;
+			bool _original_newlines_recorded = false;
 	};
 
+	using Json_reader = Basic_json_reader<Error_callback>;
 
 
-	inline Json_reader::Json_reader(std::istream& stream, Error_handler ehandler)
-	    : _stream(stream), _error_handler(ehandler) {
+
+	template<class Error_policy>
+	inline Basic_json_reader<Error_policy>::Basic_json_reader(std::istream& stream, Error_policy error_policy)
+	    : _stream(&stream), _error_policy(std::move(error_policy)) {
+		_state.reserve(16);
+	}
+	template<class Error_policy>
+	inline Basic_json_reader<Error_policy>::Basic_json_reader(std::string_view buffer, Error_policy error_policy,
+	                                                          Index_mode index_mode)
+	    : _begin(buffer.data()), _pos(buffer.data()), _end(buffer.data()+buffer.size()),
+	      _error_policy(std::move(error_policy)) {
 		_state.reserve(16);
+
+		if(index_mode==Index_mode::structural) {
+			_index = Structural_index{buffer};
+			if(!_index.valid())
+				_index = Structural_index{};
+		}
+	}
+
+	template<class Error_policy>
+	inline Basic_json_reader<Error_policy>::Basic_json_reader(In_situ_t, char* buffer, std::size_t size,
+	                                                          Error_policy error_policy, Index_mode index_mode)
+	    : Basic_json_reader(std::string_view(buffer, size), std::move(error_policy), index_mode) {
+		_mutable_begin = buffer;
+	}
+
+	template<class Error_policy>
+	inline auto Basic_json_reader<Error_policy>::row()const noexcept -> uint32_t {
+		return position_of(_pos).first;
+	}
+	template<class Error_policy>
+	inline auto Basic_json_reader<Error_policy>::column()const noexcept -> uint32_t {
+		return position_of(_pos).second;
 	}
 
-	inline void Json_reader::_on_error(const std::string& e) {
+	template<class Error_policy>
+	inline auto Basic_json_reader<Error_policy>::position_of(const char* p)const -> std::pair<uint32_t, uint32_t> {
+		if(!_index.positions().empty() || _original_newlines_recorded) {
+			auto& nl = !_index.positions().empty() ? _index.newlines() : _original_newlines;
+			auto offset = static_cast<uint32_t>(p - _begin);
+			auto line = std::lower_bound(nl.begin(), nl.end(), offset);
+			return {1u + static_cast<uint32_t>(line - nl.begin()), line==nl.begin() ? offset+1 : offset - *(line-1)};
+		}
+
+		// in stream mode only the buffered part is scanned, everything before has been counted by _refill
+		auto begin = _stream ? static_cast<const char*>(_stream_buffer.data()) : _begin;
+		auto row = 1 + _discarded_rows;
+		auto line_begin = begin;
+		auto line_prefix = _discarded_line_length;
+
+		for(auto i=begin; i<p; i++) {
+			if(*i=='\n') {
+				row++;
+				line_begin = i+1;
+				line_prefix = 0;
+			}
+		}
+		return {row, static_cast<uint32_t>(line_prefix + static_cast<std::size_t>(p - line_begin) + 1)};
+	}
+
+	template<class Error_policy>
+	template<class Message>
+	inline void Basic_json_reader<Error_policy>::_on_error_at(const Message& msg, uint32_t row, uint32_t column) {
 		if(_error)
 			return; // ignore all errors after the first
 
-		if(_error_handler) {
-			_error_handler(e, _row, _column);
-			_error = true;
+		_error = true;
+		_error_policy(msg, row, column);
 
-		} else {
-			std::cerr<<"Error parsing JSON at "<<_row<<":"<<_column<<" : "<<e<<std::endl;
-			abort();
-		}
+		// jump to the end, so the error doesn't have to be checked for every character
+		_pos = _end;
 	}
-	inline char Json_reader::_get() {
-		if(_error) {
-			return 0;
+	// reads more of the stream into the buffer, until at least min_size characters are available.
+	// The last consumed character is kept, so _unget() is always possible.
+	template<class Error_policy>
+	inline bool Basic_json_reader<Error_policy>::_refill(std::size_t min_size) {
+		auto sb = _stream ? _stream->rdbuf() : nullptr;
+		if(!sb || _error)
+			return false;
+
+		constexpr auto chunk_size = std::size_t(16*1024);
+
+		auto data = _stream_buffer.data();
+		auto keep_offset = static_cast<std::size_t>(_pos!=data && _pos!=nullptr ? _pos-1-data : 0);
+		auto pos_offset  = static_cast<std::size_t>(_pos!=nullptr ? _pos-data : 0);
+		auto end_offset  = static_cast<std::size_t>(_end!=nullptr ? _end-data : 0);
+		auto kept = end_offset - keep_offset;
+
+		// positions are only tracked by offset, so the lines that are discarded have to be remembered
+		auto discarded_end = data + keep_offset;
+		for(auto p=static_cast<const char*>(data); p!=discarded_end; p++) {
+			auto nl = static_cast<const char*>(std::memchr(p, '\n', static_cast<std::size_t>(discarded_end-p)));
+			if(!nl) {
+				_discarded_line_length += static_cast<std::size_t>(discarded_end-p);
+				break;
+			}
+			_discarded_rows++;
+			_discarded_line_length = 0;
+			p = nl;
 		}
 
-		auto c = _stream.get();
-		_column++;
-		if(c=='\n') {
-			_column=1;
-			_row++;
-		}
-		if(c==EOF) {
-			std::string msg = "Unexpected end of file";
-			for(auto s : _state) {
-				msg+= ". Unclosed ";
-				msg+= s==State::array ? "array" : "object";
+		if(_stream_buffer.size() < kept + std::max(min_size, chunk_size))
+			_stream_buffer.resize(kept + std::max(min_size, chunk_size));
+
+		data = _stream_buffer.data();
+		std::memmove(data, data+keep_offset, kept);
+		_pos = data + (pos_offset - keep_offset);
+		_end = data + kept;
+
+		auto capacity_end = data + _stream_buffer.size();
+		while(static_cast<std::size_t>(_end-_pos) < min_size) {
+			// only take what is already buffered, so we never block for more than one character
+			auto available = sb->in_avail();
+			if(available<=0) {
+				if(sb->sgetc()==EOF) {
+					_stream->setstate(std::ios::eofbit);
+					break;
+				}
+				available = std::max(std::streamsize(1), sb->in_avail());
 			}
-			_on_error(msg);
+
+			auto count = std::min(available, static_cast<std::streamsize>(capacity_end-_end));
+			_end += sb->sgetn(const_cast<char*>(_end), count);
 		}
-		return static_cast<char>(c);
+
+		return _pos!=_end;
 	}
-	inline void Json_reader::_unget() {
-		_stream.unget();
-		auto c = _stream.peek();
-		_column--;
-		if(c=='\n') {
-			_column = static_cast<std::uint32_t>(-1);
-			_row--;
+	// returns the characters that haven't been consumed to the stream
+	template<class Error_policy>
+	inline void Basic_json_reader<Error_policy>::_release_stream() {
+		auto sb = _stream ? _stream->rdbuf() : nullptr;
+		if(!sb)
+			return;
+
+		for(auto p=_end; p!=_pos; _end=--p) {
+			if(sb->sputbackc(*(p-1))==EOF)
+				break;
 		}
 	}
-	inline void Json_reader::_mark() {
-		_marked_pos = _stream.tellg();
-		_saved_column = _column;
-		_saved_row = _row;
+	template<class Error_policy>
+	inline int Basic_json_reader<Error_policy>::_underflow() {
+		if(_refill())
+			return static_cast<unsigned char>(*_pos++);
+
+		return EOF;
+	}
+	template<class Error_policy>
+	inline int Basic_json_reader<Error_policy>::_peek_raw() {
+		if(_pos==_end && !_refill())
+			return EOF;
+
+		return static_cast<unsigned char>(*_pos);
 	}
-	inline void Json_reader::_rewind() {
-		_stream.seekg(_marked_pos);
-		_column = _saved_column;
-		_row = _saved_row;
+	template<class Error_policy>
+	inline char Basic_json_reader<Error_policy>::_get() {
+		auto c = _pos!=_end ? static_cast<int>(static_cast<unsigned char>(*_pos++)) : _underflow();
+		if(c==EOF) {
+			_on_error([&] {
+				std::string msg = "Unexpected end of file";
+				for(auto s : _state) {
+					msg+= ". Unclosed ";
+					msg+= s==State::array ? "array" : "object";
+				}
+				return msg;
+			});
+		}
+		return static_cast<char>(c);
 	}
+	template<class Error_policy>
+	inline void Basic_json_reader<Error_policy>::_unget() {
+		if(_error) {
+			return;
+		}
 
-	inline char Json_reader::_next(bool in_string) {
+		--_pos;
+	}
+	template<class Error_policy>
+	inline char Basic_json_reader<Error_policy>::_next(bool in_string) {
 		if(_error) {
 			return 0;
 		}
 
+		if(!in_string && !_index.positions().empty())
+			return _next_indexed();
+
 		auto c = _get();
 
 		if(!in_string) {
 			while(!_error && !std::isgraph(c)) {
+				_skip_blanks();
 				c = _get();
 			}
 		}
 
-		if(c=='/' && !in_string && _stream.peek()=='*') { // comment
+		if(c=='/' && !in_string && _peek_raw()=='*') { // comment
 			_get();
-
-			while(!_error) {
-				auto nc = _get();
-				if(c=='*' && nc=='/')
-					break;
-				else
-					c = nc;
-			}
+			_skip_comment_body();
 			c=_get();
 		}
 
 		if(!in_string) {
 			while(!_error && !std::isgraph(c)) {
+				_skip_blanks();
 				c = _get();
 			}
 		}
 
 		return c;
 	}
-	inline void Json_reader::_post_read() {
+	template<class Error_policy>
+	inline void Basic_json_reader<Error_policy>::_skip_blanks() {
+		auto blanks_end = details::skip_blanks(_pos, _end);
+		_pos = blanks_end;
+	}
+
+	template<class Error_policy>
+	inline char Basic_json_reader<Error_policy>::_next_indexed() {
+		if(_pos!=_end && std::isgraph(static_cast<unsigned char>(*_pos)))
+			return _get();
+
+		// jump over the whitespace to the next token
+		auto& positions = _index.positions();
+		auto offset = static_cast<uint32_t>(_pos - _begin);
+		while(_index_pos<positions.size() && positions[_index_pos]<offset)
+			_index_pos++;
+
+		_pos = _index_pos<positions.size() ? _begin + positions[_index_pos] : _end;
+		return _get();
+	}
+	// expects _pos to be directly behind the opening quote
+	template<class Error_policy>
+	inline bool Basic_json_reader<Error_policy>::_read_indexed(std::string& val) {
+		auto& positions = _index.positions();
+		auto offset = static_cast<uint32_t>(_pos - _begin - 1);
+		while(_index_pos<positions.size() && positions[_index_pos]<offset)
+			_index_pos++;
+
+		if(_index_pos+1>=positions.size() || positions[_index_pos]!=offset)
+			return false;
+
+		auto str_end = _begin + positions[_index_pos+1];
+		auto str = std::string_view(_pos, static_cast<std::size_t>(str_end-_pos));
+		if(str.find('\\')==std::string_view::npos) {
+			val.assign(str.data(), str.size());
+
+		} else {
+			val.clear();
+			for(auto i=std::size_t(0); i<str.size(); i++) {
+				if(str[i]!='\\') {
+					val+=str[i];
+					continue;
+				}
+
+				char decoded[4];
+				auto length = details::decode_escape([&] {return ++i<str.size() ? str[i] : '\0';}, decoded);
+				if(length==0) {
+					_on_error("Invalid escape sequence in string");
+					return true;
+				}
+				val.append(decoded, length);
+			}
+		}
+
+		_pos = str_end + 1;
+		_index_pos += 2;
+		return true;
+	}
+	// expects _pos to be directly behind the opening bracket
+	template<class Error_policy>
+	inline bool Basic_json_reader<Error_policy>::_skip_nested_indexed() {
+		auto& positions = _index.positions();
+		auto offset = static_cast<uint32_t>(_pos - _begin - 1);
+		while(_index_pos<positions.size() && positions[_index_pos]<offset)
+			_index_pos++;
+
+		if(_index_pos>=positions.size() || positions[_index_pos]!=offset)
+			return false;
+
+		// quotes and scalars are just skipped, because their content is never part of the index
+		int depth = 0;
+		for(auto i=_index_pos; i<positions.size(); i++) {
+			auto c = _begin[positions[i]];
+			if(c=='{' || c=='[') {
+				depth++;
+			} else if((c=='}' || c==']') && --depth==0) {
+				_pos = _begin + positions[i] + 1;
+				_index_pos = i + 1;
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	template<class Error_policy>
+	inline void Basic_json_reader<Error_policy>::_post_read() {
+		if(_state.empty()) {
+			_release_stream(); // top-level value is complete
+			return;
+		}
+
 		if(_state.back()==State::obj_key) {
 			_state.back() = State::obj_value;
 			auto c = _next();
@@ -205,23 +605,12 @@ namespace format {
 		}
 	}
 
+	template<class Error_policy>
 	template<typename T>
-	T Json_reader::_read_decimal() {
-		auto val = 0.0;
-
-		char c=_next();
-		for(double dec=10; c>='0' && c<='9'; c=_get(), dec*=10.0)
-			val += (c-'0') / dec;
-
-		_unget();
-
-		return static_cast<T>(val);
-	}
-
-	template<typename T>
-	T Json_reader::_read_int() {
+	T Basic_json_reader<Error_policy>::_read_int() {
 		auto val = std::uint64_t(0);
 		bool negativ = false;
+		bool overflow = false;
 
 		char c = _next();
 
@@ -230,64 +619,187 @@ namespace format {
 			c = _next();
 		}
 
-		for(; c>='0' && c<='9'; c=_get())
-			val = (10u*val) + static_cast<std::uint64_t>((c-'0'));
+		if(c<'0' || c>'9') {
+			if(!_error)
+				_on_error([&] {return std::string("Unexpected character ")+c+" in integer";});
+			return T(0);
+		}
 
-		_unget();
+		auto append_digit = [&](char digit) {
+			auto d = static_cast<std::uint64_t>(digit-'0');
+			if(val > (std::numeric_limits<std::uint64_t>::max()-d) / 10u)
+				overflow = true;
+			val = (10u*val) + d;
+		};
 
-		if constexpr(std::numeric_limits<T>::is_signed) {
-			if(negativ)
-				return static_cast<T>( -static_cast<T>(val) );
-			else if(val<=static_cast<std::uint64_t>(std::numeric_limits<T>::max()))
-				return static_cast<T>(val);
+		auto p = _pos - 1;
+		// eight digits at a time, as long as the result can't overflow
+		while(val<=99'999'999'999u && _end-p>=8 && details::is_eight_digits(p)) {
+			val = val*100'000'000u + details::parse_eight_digits(p);
+			p += 8;
+		}
+		for(; p!=_end && *p>='0' && *p<='9'; p++)
+			append_digit(*p);
 
-		} else {
-			if(negativ) {
-				_on_error("Negative value -"+std::to_string(val)+" for signed type "+typeid(T).name());
-				return static_cast<T>(std::numeric_limits<T>::max() - static_cast<T>(val));
+		_pos = p;
 
-			} else if(val<=std::numeric_limits<T>::max())
-				return static_cast<T>(val);
+		// the number might continue behind the buffered part of the stream
+		if(_pos==_end && _stream) {
+			for(auto nc=_peek_raw(); nc>='0' && nc<='9'; nc=_peek_raw())
+				append_digit(_get());
 		}
 
-		_on_error("Overflow! Value -"+std::to_string(val)+" doesn't fit in type "+typeid(T).name());
+		if(!overflow) {
+			if constexpr(std::numeric_limits<T>::is_signed) {
+				constexpr auto max = static_cast<std::uint64_t>(std::numeric_limits<T>::max());
+				if(negativ && val<=max+1u)
+					return val==0 ? T(0) : static_cast<T>(-static_cast<std::int64_t>(val-1u) - 1);
+				else if(!negativ && val<=max)
+					return static_cast<T>(val);
+
+			} else {
+				if(negativ) {
+					_on_error([&] {return "Negative value -"+std::to_string(val)+" for unsigned type "+typeid(T).name();});
+					return static_cast<T>(std::numeric_limits<T>::max() - static_cast<T>(val));
+
+				} else if(val<=std::numeric_limits<T>::max())
+					return static_cast<T>(val);
+			}
+		}
+
+		_on_error([&] {return "Overflow! Value "+std::string(negativ?"-":"")+std::to_string(val)+" doesn't fit in type "+typeid(T).name();});
 		return static_cast<T>(val);
 	}
 
+	// strtod expects the decimal point of the current C locale, so the '.' of JSON is replaced by it first.
+	// length is set to the number of parsed characters
+	template<class Error_policy>
 	template<typename T>
-	T Json_reader::_read_float() {
-		bool negativ = false;
+	T Basic_json_reader<Error_policy>::_strto(std::string& str, std::size_t& length) {
+		auto decimal_point = std::localeconv()->decimal_point;
+		if(decimal_point && decimal_point[0]!='\0' && decimal_point[0]!='.' && decimal_point[1]=='\0')
+			std::replace(str.begin(), str.end(), '.', decimal_point[0]);
+
+		char* str_end = nullptr;
+		auto val = T(0);
+		if constexpr(std::is_same_v<T, float>)
+			val = std::strtof(str.c_str(), &str_end);
+		else
+			val = std::strtod(str.c_str(), &str_end);
 
-		_mark();
-		if(_next()=='-') {
-			negativ = true;
-		} else
-			_rewind();
+		length = static_cast<std::size_t>(str_end - str.c_str());
+		return val;
+	}
 
+	// value of a valid number that is too large or too small for T, i.e. +-inf or +-0
+	template<class Error_policy>
+	template<typename T>
+	T Basic_json_reader<Error_policy>::_out_of_range_float(const char* begin, const char* end) {
+		auto negative = begin!=end && *begin=='-';
+		auto p = begin + (negative ? 1 : 0);
+
+		// decimal exponent of the first significant digit
+		auto exponent = 0L;
+		auto significant = false;
+		auto fraction = false;
+		for(; p!=end && *p!='e' && *p!='E'; p++) {
+			if(*p=='.')
+				fraction = true;
+			else if(significant && !fraction)
+				exponent++;
+			else if(!significant && fraction)
+				exponent--;
+
+			significant |= *p>='1' && *p<='9';
+		}
+
+		auto explicit_exponent = 0L;
+		auto negative_exponent = false;
+		if(p!=end) {
+			p++;
+			negative_exponent = p!=end && *p=='-';
+			if(p!=end && (*p=='-' || *p=='+'))
+				p++;
+			for(; p!=end; p++) // saturated, because only the sign of the result matters
+				explicit_exponent = std::min(explicit_exponent*10 + (*p-'0'), 100000L);
+		}
+		exponent += negative_exponent ? -explicit_exponent : explicit_exponent;
 
-		auto val = static_cast<T>(_read_int<std::uint64_t>());
+		auto val = significant && exponent>=0 ? std::numeric_limits<T>::infinity() : T(0);
+		return negative ? -val : val;
+	}
 
-		char c = _get();
+	template<class Error_policy>
+	template<typename T>
+	T Basic_json_reader<Error_policy>::_read_float() {
+		auto is_number_char = [](int c) {
+			return (c>='0' && c<='9') || c=='-' || c=='+' || c=='.' || c=='e' || c=='E';
+		};
 
-		if(c=='.') {
-			val += _read_decimal<T>();
-			c = _get();
+		_next();
+		if(_error)
+			return T(0);
+
+		// the number is parsed in place if it's completely buffered, otherwise it's collected first
+		auto begin = _pos - 1;
+		auto end = _pos;
+
+#ifdef __cpp_lib_to_chars
+		if(!_stream) {
+			// from_chars finds the end itself, but also accepts inf and nan, which aren't valid JSON
+			auto digits = begin + (*begin=='-' || *begin=='+' ? 1 : 0);
+			if(digits!=_end && ((*digits>='0' && *digits<='9') || *digits=='.')) {
+				auto val = T(0);
+				auto result = std::from_chars(begin + (*begin=='+' ? 1 : 0), _end, val);
+				if(result.ec==std::errc() && (result.ptr==_end || !is_number_char(*result.ptr))) {
+					_pos = result.ptr;
+					return val;
+				}
+			}
 		}
+#endif
+
+		while(end!=_end && is_number_char(*end))
+			end++;
 
-		if(c=='e' || c=='E') {
-			int64_t exp = _read_int<int64_t>();
+		_pos = end;
 
-			val *= static_cast<T>(std::pow(exp>0 ? 10.0 : 0.1, static_cast<double>(std::abs(exp))));
-		}else
-			_unget();
+		if(_pos==_end && _stream) {
+			_number_buffer.assign(begin, end);
+			while(is_number_char(_peek_raw()))
+				_number_buffer += _get();
+
+			begin = _number_buffer.data();
+			end = begin + _number_buffer.size();
+		}
 
-		if( negativ )
-			val*=-1;
+		if(begin!=end && *begin=='+')
+			begin++;
+
+		auto val = T(0);
+#ifdef __cpp_lib_to_chars
+		auto result = std::from_chars(begin, end, val);
+		if(result.ec==std::errc::result_out_of_range && result.ptr==end) {
+			// from_chars reports overflows and underflows to zero as errors, instead of saturating
+			val = _out_of_range_float<T>(begin, end);
+
+		} else if(result.ec!=std::errc() || result.ptr!=end) {
+			_on_error([&] {return "Invalid number '"+std::string(begin, end)+"'";});
+		}
+#else
+		auto str = std::string(begin, end);
+		auto length = std::size_t(0);
+		val = _strto<T>(str, length);
+		if(str.empty() || length!=str.size()) {
+			_on_error([&] {return "Invalid number '"+std::string(begin, end)+"'";});
+		}
+#endif
 
 		return val;
 	}
 
-	inline bool Json_reader::in_obj() {
+	template<class Error_policy>
+	inline bool Basic_json_reader<Error_policy>::in_obj() {
 		auto c = _next();
 
 		switch(c) {
@@ -310,17 +822,17 @@ namespace format {
 			case '}':
 				assert(!_state.empty() &&_state.back()==State::obj_value);
 				_state.pop_back();
-				if(!_state.empty())
-					_post_read();
+				_post_read();
 				return false;
 
 			default:
-				_on_error(std::string("Unexpected character ")+c+" in object");
+				_on_error([&] {return std::string("Unexpected character ")+c+" in object";});
 				return false;
 		}
 	}
 
-	inline bool Json_reader::in_array() {
+	template<class Error_policy>
+	inline bool Basic_json_reader<Error_policy>::in_array() {
 		auto c = _next();
 
 		switch(c) {
@@ -347,60 +859,256 @@ namespace format {
 				return false;
 
 			default:
-				_on_error(std::string("Unexpected character ")+c+" in array");
+				_on_error([&] {return std::string("Unexpected character ")+c+" in array";});
 				return false;
 		}
 	}
 
-	inline void Json_reader::skip_obj() {
+	template<class Error_policy>
+	inline void Basic_json_reader<Error_policy>::skip_obj() {
 		auto c = _next();
 		if(c!='{') {
-			_on_error(std::string("Unexpected character ")+c+" in object");
+			_on_error([&] {return std::string("Unexpected character ")+c+" in object";});
 			return;
 		}
 
-		int obj_depth = 1;
-		while(obj_depth>0) {
-			switch(_next()) {
+		_skip_nested();
+		_post_read();
+	}
+
+	template<class Error_policy>
+	inline void Basic_json_reader<Error_policy>::skip_value() {
+		auto c = _next();
+
+		switch(c) {
+			case '{':
+			case '[':
+				_skip_nested();
+				break;
+
+			case '"':
+				_skip_string_body();
+				break;
+
+			case ',':
+			case ':':
+			case '}':
+			case ']':
+				_on_error([&] {return std::string("Unexpected character ")+c+", expected a value";});
+				return;
+
+			default: // number or literal
+				for(auto nc=_peek_raw(); nc!=EOF && std::isgraph(nc) && nc!=',' && nc!='}' && nc!=']' && nc!='/';
+				    nc=_peek_raw())
+					_get();
+				break;
+		}
+
+		_post_read();
+	}
+
+	template<class Error_policy>
+	inline auto Basic_json_reader<Error_policy>::_size_hint(char open) -> std::size_t {
+		if(_index.positions().empty() || _error || peek()!=open)
+			return 0;
+
+		auto& positions = _index.positions();
+		auto offset = static_cast<uint32_t>(_pos - _begin);
+		auto i = _index_pos;
+		while(i<positions.size() && positions[i]<offset)
+			i++;
+
+		if(i>=positions.size() || positions[i]!=offset)
+			return 0;
+
+		// elements are separated by the commas that are directly inside the array/object
+		auto commas = std::size_t(0);
+		auto empty = true;
+		int depth = 0;
+		for(; i<positions.size(); i++) {
+			auto c = _begin[positions[i]];
+			if(c=='}' || c==']') {
+				if(--depth==0)
+					return empty ? 0 : commas+1;
+			} else if(depth==1) {
+				if(c==',')
+					commas++;
+				else
+					empty = false;
+			}
+
+			if(c=='{' || c=='[')
+				depth++;
+		}
+
+		return 0;
+	}
+
+	template<class Error_policy>
+	template<typename T, class Allocator>
+	inline bool Basic_json_reader<Error_policy>::read_numbers(std::vector<T, Allocator>& out) {
+		static_assert(std::is_arithmetic<T>::value && !std::is_same<T, bool>::value, "Not a number type");
+
+		if(_stream || _error || peek()!='[')
+			return false;
+
+		_next();
+		out.clear();
+
+		if(peek()!=']') {
+			while(!_error) {
+				if constexpr(std::is_floating_point<T>::value)
+					out.push_back(_read_float<T>());
+				else
+					out.push_back(_read_int<T>());
+
+				auto c = _next();
+				if(c==']') {
+					_unget();
+					break;
+				} else if(c!=',') {
+					_on_error([&] {return std::string("Unexpected character ")+c+" in array";});
+					return true;
+				}
+			}
+		}
+
+		_next(); // ]
+		_post_read();
+		return true;
+	}
+
+	template<class Error_policy>
+	inline bool Basic_json_reader<Error_policy>::read_array_elements(std::vector<std::string_view>& elements) {
+		if(_stream || _arena || _mutable_begin || _error || peek()!='[')
+			return false;
+
+		_next();
+		_state.push_back(State::array);
+		elements.clear();
+
+		if(peek()!=']')
+			_split_array(elements);
+		else {
+			_next(); // ]
+			_state.pop_back();
+			_post_read();
+		}
+		return true;
+	}
+	template<class Error_policy>
+	inline bool Basic_json_reader<Error_policy>::read_remaining_array_elements(std::vector<std::string_view>& elements) {
+		if(_stream || _arena || _mutable_begin || _error)
+			return false;
+
+		assert(!_state.empty() && _state.back()==State::array);
+		elements.clear();
+		_split_array(elements);
+		return true;
+	}
+	// expects _pos to be in front of an element and consumes the rest of the array
+	template<class Error_policy>
+	inline void Basic_json_reader<Error_policy>::_split_array(std::vector<std::string_view>& elements) {
+		while(!_error) {
+			peek(); // skip whitespace
+			auto element_begin = _pos;
+			skip_value();
+			elements.emplace_back(element_begin, static_cast<std::size_t>(_pos - element_begin));
+
+			auto c = _next();
+			if(c==']') {
+				_unget();
+				break;
+			} else if(c!=',') {
+				_on_error([&] {return std::string("Unexpected character ")+c+" in array";});
+				return;
+			}
+		}
+
+		_next(); // ]
+		_state.pop_back();
+		_post_read();
+	}
+
+	// expects _pos to be directly behind the opening bracket
+	template<class Error_policy>
+	inline void Basic_json_reader<Error_policy>::_skip_nested() {
+		if(!_index.positions().empty() && _skip_nested_indexed())
+			return;
+
+		// brackets are only counted, so mismatched pairs are not detected
+		int depth = 1;
+		while(!_error) {
+			auto special = details::find_structure_special(_pos, _end);
+			_pos = special;
+
+			switch(_get()) {
 				case '{':
-					obj_depth++;
+				case '[':
+					depth++;
 					break;
 				case '}':
-					obj_depth--;
+				case ']':
+					if(--depth==0)
+						return;
+					break;
+				case '"':
+					_skip_string_body();
 					break;
-				case '"': {
-					auto str_c = _get();
-					while(str_c!='"') {
-						if(str_c=='\\') _get();
-						str_c = _get();
+				case '/':
+					if(_peek_raw()=='*') {
+						_get();
+						_skip_comment_body();
 					}
 					break;
-				}
 				default:
-					if(_error) {
-						return;
-					}
-
-					break; // skip
+					break; // any character behind the end of the stream buffer, after it has been refilled
 			}
 		}
-
-		_post_read();
 	}
+	template<class Error_policy>
+	inline void Basic_json_reader<Error_policy>::_skip_string_body() {
+		while(!_error) {
+			auto special = details::find_string_special(_pos, _end);
+			_pos = special;
+
+			auto c = _get();
+			if(c=='"')
+				return;
+			else if(c=='\\')
+				_get();
+		}
+	}
+	template<class Error_policy>
+	inline void Basic_json_reader<Error_policy>::_skip_comment_body() {
+		auto c = _get();
+		while(!_error) {
+			auto nc = _get();
+			if(c=='*' && nc=='/')
+				return;
+			c = nc;
+		}
+	}
+
+	template<class Error_policy>
+	inline bool Basic_json_reader<Error_policy>::read_nullptr() { // look-ahead if false
+		if(peek()!='n' || _error)
+			return false;
 
-	inline bool Json_reader::read_nullptr() { // look-ahead if false
-		_mark();
+		if(static_cast<std::size_t>(_end-_pos)<4)
+			_refill(4);
 
-		if(_next()=='n' && _get()=='u' && _get()=='l' && _get()=='l') {
+		if(_end-_pos>=4 && std::memcmp(_pos, "null", 4)==0) {
+			_pos += 4;
 			_post_read();
 			return true;
 		}
 
-		_rewind();
 		return false;
 	}
 
-	inline void Json_reader::read(std::string& val) {
+	template<class Error_policy>
+	inline void Basic_json_reader<Error_policy>::read(std::string& val) {
 		auto c = _next();
 
 		if(c!='\"') {
@@ -408,22 +1116,137 @@ namespace format {
 			return;
 		}
 
-		c = _get();
+		if(!_index.positions().empty() && _read_indexed(val)) {
+			_post_read();
+			return;
+		}
+
+		_read_string_body(val);
+
+		_post_read();
+	}
+
+	template<class Error_policy>
+	inline void Basic_json_reader<Error_policy>::read(std::string_view& val) {
+		auto c = _next();
+
+		if(c!='\"') {
+			_on_error("Missing '\"' at the start of string");
+			return;
+		}
 
+		if(!_stream) {
+			// strings without escape sequences are referenced directly
+			auto str_end = details::find_string_special(_pos, _end);
+			if(str_end!=_end && *str_end=='"') {
+				val = std::string_view(_pos, static_cast<std::size_t>(str_end - _pos));
+				_pos = str_end + 1;
+				_post_read();
+				return;
+			}
+		}
+
+		if(_mutable_begin) {
+			val = _read_string_body_in_situ();
+			_post_read();
+			return;
+		}
+
+		_read_string_body(_string_buffer);
+
+		if(_arena)
+			val = _arena->store(_string_buffer);
+		else
+			_on_error("String can't be referenced from the input and no String_arena has been provided");
+
+		_post_read();
+	}
+
+	template<class Error_policy>
+	inline auto Basic_json_reader<Error_policy>::read_key(std::string& buffer) -> std::string_view {
+		auto c = _next();
+
+		if(c!='\"') {
+			_on_error("Missing '\"' at the start of string");
+			buffer.clear();
+			return buffer;
+		}
+
+		auto str_end = details::find_string_special(_pos, _end);
+		// the ':' has to be buffered, too, because a refill of the stream buffer would move the key
+		if(str_end!=_end && *str_end=='"' && (!_stream || (str_end+1!=_end && str_end[1]==':'))) {
+			auto key = std::string_view(_pos, static_cast<std::size_t>(str_end - _pos));
+			_pos = str_end + 1;
+			_post_read();
+			return key;
+		}
+
+		_read_string_body(buffer);
+		_post_read();
+		return buffer;
+	}
+
+	// expects _pos to be directly behind the opening quote
+	template<class Error_policy>
+	inline void Basic_json_reader<Error_policy>::_read_string_body(std::string& val) {
 		val.clear();
-		while(c!='"') {
-			if(c=='\\')
-				val+=_get();
-			else
+		while(!_error) {
+			// append everything up to the next special character in one piece
+			auto run_end = details::find_string_special(_pos, _end);
+			val.append(_pos, static_cast<std::size_t>(run_end - _pos));
+			_pos = run_end;
+
+			auto c = _get();
+			if(c=='"')
+				break;
+			else if(c=='\\') {
+				char decoded[4];
+				auto length = details::decode_escape([&] {return _get();}, decoded);
+				if(length==0)
+					_on_error("Invalid escape sequence in string");
+				val.append(decoded, length);
+			} else
 				val+=c;
+		}
+	}
 
-			c = _get();
+	// decodes the string into the space it occupied, the rest of it is left untouched
+	template<class Error_policy>
+	inline std::string_view Basic_json_reader<Error_policy>::_read_string_body_in_situ() {
+		if(_index.positions().empty() && !_original_newlines_recorded) {
+			for(auto i=_begin; (i=static_cast<const char*>(std::memchr(i, '\n', static_cast<std::size_t>(_end-i)))); i++)
+				_original_newlines.push_back(static_cast<std::uint32_t>(i - _begin));
+			_original_newlines_recorded = true;
 		}
 
-		_post_read();
+		auto str_begin = _mutable_begin + (_pos - _begin);
+		auto out = str_begin;
+
+		while(!_error) {
+			auto run_end = details::find_string_special(_pos, _end);
+			auto run_length = static_cast<std::size_t>(run_end - _pos);
+			if(out!=_pos)
+				std::memmove(out, _pos, run_length);
+			out += run_length;
+			_pos = run_end;
+
+			auto c = _get();
+			if(c=='"')
+				break;
+			else if(c=='\\') {
+				auto length = details::decode_escape([&] {return _get();}, out);
+				if(length==0)
+					_on_error("Invalid escape sequence in string");
+				out += length;
+			} else
+				*out++ = c;
+		}
+
+		return std::string_view(str_begin, static_cast<std::size_t>(out - str_begin));
 	}
 
-	inline void Json_reader::read(bool& val) {
+	template<class Error_policy>
+	inline void Basic_json_reader<Error_policy>::read(bool& val) {
 		char chars[] {
 		    _next(),
 		    _get(),
@@ -436,66 +1259,76 @@ namespace format {
 		else if(chars[0]=='f' && chars[1]=='a' && chars[2]=='l' && chars[3]=='s' && _get()=='e')
 			val = false;
 		else
-			_on_error(std::string("Unknown boolean constant '")+chars+"'");
+			_on_error([&] {return "Unknown boolean constant '"+std::string(chars, 4)+"'";});
 
 		_post_read();
 	}
 
-	inline void Json_reader::read(float& val) {
+	template<class Error_policy>
+	inline void Basic_json_reader<Error_policy>::read(float& val) {
 		val = _read_float<float>();
 
 		_post_read();
 	}
 
-	inline void Json_reader::read(double& val) {
+	template<class Error_policy>
+	inline void Basic_json_reader<Error_policy>::read(double& val) {
 		val = _read_float<double>();
 
 		_post_read();
 	}
 
-	inline void Json_reader::read(uint8_t& val) {
+	template<class Error_policy>
+	inline void Basic_json_reader<Error_policy>::read(uint8_t& val) {
 		val = _read_int<uint8_t>();
 
 		_post_read();
 	}
 
-	inline void Json_reader::read(int8_t& val) {
+	template<class Error_policy>
+	inline void Basic_json_reader<Error_policy>::read(int8_t& val) {
 		val = _read_int<int8_t>();
 
 		_post_read();
 	}
 
-	inline void Json_reader::read(uint16_t& val) {
+	template<class Error_policy>
+	inline void Basic_json_reader<Error_policy>::read(uint16_t& val) {
 		val = _read_int<uint16_t>();
 
 		_post_read();
 	}
 
-	inline void Json_reader::read(int16_t& val) {
+	template<class Error_policy>
+	inline void Basic_json_reader<Error_policy>::read(int16_t& val) {
 		val = _read_int<int16_t>();
 
 		_post_read();
 	}
 
-	inline void Json_reader::read(uint32_t& val) {
+	template<class Error_policy>
+	inline void Basic_json_reader<Error_policy>::read(uint32_t& val) {
 		val = _read_int<uint32_t>();
 
 		_post_read();
 	}
 
-	inline void Json_reader::read(int32_t& val) {
+	template<class Error_policy>
+	inline void Basic_json_reader<Error_policy>::read(int32_t& val) {
 		val = _read_int<int32_t>();
 
 		_post_read();
 	}
 
-	inline void Json_reader::read(uint64_t& val) {
+	template<class Error_policy>
+	inline void Basic_json_reader<Error_policy>::read(uint64_t& val) {
 		val = _read_int<uint64_t>();
 
 		_post_read();
 	}
 
-	inline void Json_reader::read(int64_t& val) {
+	template<class Error_policy>
+	inline void Basic_json_reader<Error_policy>::read(int64_t& val) {
 		val = _read_int<int64_t>();
 
 		_post_read();
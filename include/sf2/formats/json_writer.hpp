@@ -17,6 +17,7 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <ostream>
 #include <vector>
 #include <cassert>
@@ -24,9 +25,14 @@
 namespace sf2 {
 namespace format {
 
+	enum class Json_style {
+		pretty,  // indented, one value per line
+		compact  // every top-level value on a single line, e.g. for NDJSON
+	};
+
 	class Json_writer {
 		public:
-			Json_writer(std::ostream& stream);
+			Json_writer(std::ostream& stream, Json_style style=Json_style::pretty);
 
 			void begin_obj();
 			void begin_array();
@@ -37,6 +43,7 @@ namespace format {
 			void write(const char*);
 			void write(const char*, std::size_t len);
 			void write(const std::string&);
+			void write(std::string_view);
 			void write(bool);
 			void write(float);
 			void write(double);
@@ -64,15 +71,19 @@ namespace format {
 
 			std::ostream& _stream;
 			std::vector<State> _state;
+			Json_style _style;
 	};
 
 
 
-	inline Json_writer::Json_writer(std::ostream& stream) : _stream(stream) {
+	inline Json_writer::Json_writer(std::ostream& stream, Json_style style) : _stream(stream), _style(style) {
 		_state.reserve(16);
 	}
 
 	inline void Json_writer::newline() {
+		if(_style==Json_style::compact)
+			return;
+
 		_stream.put('\n');
 		for(std::size_t i=0; i<_state.size(); ++i)
 			_stream<<"    ";
@@ -108,7 +119,7 @@ namespace format {
 			_state.back()=State::obj_key;
 
 		} else if(_state.back()==State::obj_key) {
-			_stream<<": ";
+			_stream<<(_style==Json_style::compact ? ":" : ": ");
 			_state.back()=State::obj_value;
 		}
 	}
@@ -145,8 +156,12 @@ namespace format {
 
 		_post_write();
 
-		if(_state.empty())
-			_stream<<std::endl;
+		if(_state.empty()) {
+			if(_style==Json_style::compact)
+				_stream.put('\n'); // no flush, because compact output is usually written in bulk
+			else
+				_stream<<std::endl;
+		}
 	}
 
 	inline void Json_writer::begin_obj() {
@@ -170,40 +185,55 @@ namespace format {
 	}
 
 	inline void Json_writer::write(const char* v) {
-		_pre_write();
-
-		_stream.put('"');
-
-		std::size_t i=0;
-		char c = v[i];
-		while(c!='\0') {
-			if(c=='"')
-				_stream.put('\\');
-
-			_stream.put(c);
-			c = v[++i];
-		}
-
-		_stream.put('"');
-
-		_post_write();
+		write(std::string_view(v));
 	}
 	inline void Json_writer::write(const char* v, std::size_t len) {
+		write(std::string_view(v, len));
+	}
+
+	inline void Json_writer::write(const std::string& v) {
+		write(std::string_view(v));
+	}
+	inline void Json_writer::write(std::string_view v) {
 		_pre_write();
 
 		_stream.put('"');
 
-		_stream.write(v, static_cast<std::streamsize>(len));
+		// quotes, backslashes and control characters are escaped, so every value fits on a single line
+		auto run_begin = std::size_t(0);
+		for(auto i=std::size_t(0); i<v.size(); i++) {
+			auto c = static_cast<unsigned char>(v[i]);
+			if(c!='"' && c!='\\' && c>=0x20)
+				continue;
+
+			_stream.write(v.data()+run_begin, static_cast<std::streamsize>(i-run_begin));
+			run_begin = i+1;
+
+			_stream.put('\\');
+			switch(c) {
+				case '\n': _stream.put('n'); break;
+				case '\r': _stream.put('r'); break;
+				case '\t': _stream.put('t'); break;
+				case '\b': _stream.put('b'); break;
+				case '\f': _stream.put('f'); break;
+				case '"':
+				case '\\': _stream.put(static_cast<char>(c)); break;
+				default: {
+					constexpr auto hex = "0123456789abcdef";
+					_stream.write("u00", 3);
+					_stream.put(hex[c>>4]);
+					_stream.put(hex[c&0xf]);
+					break;
+				}
+			}
+		}
+		_stream.write(v.data()+run_begin, static_cast<std::streamsize>(v.size()-run_begin));
 
 		_stream.put('"');
 
 		_post_write();
 	}
 
-	inline void Json_writer::write(const std::string& v) {
-		write(v.c_str());
-	}
-
 	inline void Json_writer::write(bool v) {
 		_write(v ? "true" : "false");
 	}
@@ -0,0 +1,179 @@
+/***********************************************************\
+ * SIMD helpers for the JSON reader                        *
+ *     ___________ _____                                   *
+ *    /  ___|  ___/ __  \                                  *
+ *    \ `--.| |_  `' / /'                                  *
+ *     `--. \  _|   / /                                    *
+ *    /\__/ / |   ./ /___                                  *
+ *    \____/\_|   \_____/                                  *
+ *                                                         *
+ *                                                         *
+ *  Copyright (c) 2014 Florian Oetke                       *
+ *                                                         *
+ *  This file is part of SF2 and distributed under         *
+ *  the MIT License. See LICENSE file for details.         *
+\***********************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(__AVX2__)
+	#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+	#define SF2_SSE2
+#endif
+
+#ifdef _MSC_VER
+	#include <intrin.h>
+#endif
+
+namespace sf2 {
+namespace format {
+namespace details {
+
+	inline auto trailing_zeros(std::uint64_t v) noexcept -> int {
+#ifdef _MSC_VER
+		unsigned long i;
+		_BitScanForward64(&i, v);
+		return static_cast<int>(i);
+#else
+		return __builtin_ctzll(v);
+#endif
+	}
+	inline auto popcount(std::uint64_t v) noexcept -> int {
+#ifdef _MSC_VER
+		return static_cast<int>(__popcnt64(v));
+#else
+		return __builtin_popcountll(v);
+#endif
+	}
+
+	// SWAR digit parsing, the characters are loaded as a little endian 64 bit word
+	inline auto load_eight_chars(const char* in) noexcept -> std::uint64_t {
+		std::uint64_t v;
+		std::memcpy(&v, in, sizeof(v));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__==__ORDER_BIG_ENDIAN__
+		v = __builtin_bswap64(v);
+#endif
+		return v;
+	}
+	inline auto is_eight_digits(const char* in) noexcept -> bool {
+		auto v = load_eight_chars(in);
+		return (((v & 0xF0F0F0F0F0F0F0F0) | (((v + 0x0606060606060606) & 0xF0F0F0F0F0F0F0F0) >> 4))
+		        == 0x3333333333333333);
+	}
+	inline auto parse_eight_digits(const char* in) noexcept -> std::uint32_t {
+		constexpr auto mask = std::uint64_t(0x000000FF000000FF);
+		constexpr auto mul1 = std::uint64_t(0x000F424000000064); // 100 + (1000000 << 32)
+		constexpr auto mul2 = std::uint64_t(0x0000271000000001); // 1 + (10000 << 32)
+
+		auto v = load_eight_chars(in) - 0x3030303030303030;
+		v = (v * 10) + (v >> 8); // pairs of digits
+		v = (((v & mask) * mul1) + (((v >> 16) & mask) * mul2)) >> 32;
+		return static_cast<std::uint32_t>(v);
+	}
+
+	// first '"' or '\\' in [begin, end) or end
+	inline auto find_string_special(const char* begin, const char* end) noexcept -> const char* {
+		auto p = begin;
+#if defined(__AVX2__)
+		for(; end-p >= 32; p+=32) {
+			auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+			auto m = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('"')),
+			                         _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\')));
+			auto bits = static_cast<std::uint32_t>(_mm256_movemask_epi8(m));
+			if(bits!=0)
+				return p + trailing_zeros(bits);
+		}
+#elif defined(SF2_SSE2)
+		for(; end-p >= 16; p+=16) {
+			auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+			auto m = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('"')),
+			                      _mm_cmpeq_epi8(v, _mm_set1_epi8('\\')));
+			auto bits = static_cast<std::uint32_t>(_mm_movemask_epi8(m));
+			if(bits!=0)
+				return p + trailing_zeros(bits);
+		}
+#endif
+		for(; p!=end; p++) {
+			if(*p=='"' || *p=='\\')
+				return p;
+		}
+		return end;
+	}
+
+	// first '"', '{', '}', '[', ']' or '/' in [begin, end) or end
+	inline auto find_structure_special(const char* begin, const char* end) noexcept -> const char* {
+		auto p = begin;
+#if defined(__AVX2__)
+		for(; end-p >= 32; p+=32) {
+			auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+			// '['|0x20 == '{' and ']'|0x20 == '}'
+			auto lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+			auto m = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(lower, _mm256_set1_epi8('{')),
+			                                         _mm256_cmpeq_epi8(lower, _mm256_set1_epi8('}'))),
+			                         _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('"')),
+			                                         _mm256_cmpeq_epi8(v, _mm256_set1_epi8('/'))));
+			auto bits = static_cast<std::uint32_t>(_mm256_movemask_epi8(m));
+			if(bits!=0)
+				return p + trailing_zeros(bits);
+		}
+#elif defined(SF2_SSE2)
+		for(; end-p >= 16; p+=16) {
+			auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+			// '['|0x20 == '{' and ']'|0x20 == '}'
+			auto lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+			auto m = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(lower, _mm_set1_epi8('{')),
+			                                   _mm_cmpeq_epi8(lower, _mm_set1_epi8('}'))),
+			                      _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('"')),
+			                                   _mm_cmpeq_epi8(v, _mm_set1_epi8('/'))));
+			auto bits = static_cast<std::uint32_t>(_mm_movemask_epi8(m));
+			if(bits!=0)
+				return p + trailing_zeros(bits);
+		}
+#endif
+		for(; p!=end; p++) {
+			auto c = *p;
+			if(c=='"' || c=='{' || c=='}' || c=='[' || c==']' || c=='/')
+				return p;
+		}
+		return end;
+	}
+
+	// first character in [begin, end) that is not ' ', '\t' or '\r' or end
+	inline auto skip_blanks(const char* begin, const char* end) noexcept -> const char* {
+		auto p = begin;
+#if defined(__AVX2__)
+		for(; end-p >= 32; p+=32) {
+			auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+			auto m = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')),
+			                                         _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t'))),
+			                         _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r')));
+			auto bits = ~static_cast<std::uint32_t>(_mm256_movemask_epi8(m));
+			if(bits!=0)
+				return p + trailing_zeros(bits);
+		}
+#elif defined(SF2_SSE2)
+		for(; end-p >= 16; p+=16) {
+			auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+			auto m = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+			                                   _mm_cmpeq_epi8(v, _mm_set1_epi8('\t'))),
+			                      _mm_cmpeq_epi8(v, _mm_set1_epi8('\r')));
+			auto bits = ~static_cast<std::uint32_t>(_mm_movemask_epi8(m)) & 0xFFFFu;
+			if(bits!=0)
+				return p + trailing_zeros(bits);
+		}
+#endif
+		for(; p!=end; p++) {
+			if(*p!=' ' && *p!='\t' && *p!='\r')
+				return p;
+		}
+		return end;
+	}
+
+}
+}
+}
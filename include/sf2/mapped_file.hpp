@@ -0,0 +1,137 @@
+/***********************************************************\
+ * Read-only memory mapped files                           *
+ *     ___________ _____                                   *
+ *    /  ___|  ___/ __  \                                  *
+ *    \ `--.| |_  `' / /'                                  *
+ *     `--. \  _|   / /                                    *
+ *    /\__/ / |   ./ /___                                  *
+ *    \____/\_|   \_____/                                  *
+ *                                                         *
+ *                                                         *
+ *  Copyright (c) 2014 Florian Oetke                       *
+ *                                                         *
+ *  This file is part of SF2 and distributed under         *
+ *  the MIT License. See LICENSE file for details.         *
+\***********************************************************/
+
+#pragma once
+
+#include <string>
+#include <string_view>
+
+#ifdef _WIN32
+	#ifndef WIN32_LEAN_AND_MEAN
+		#define WIN32_LEAN_AND_MEAN
+	#endif
+	#ifndef NOMINMAX
+		#define NOMINMAX
+	#endif
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+namespace sf2 {
+
+	// maps the complete file read-only into memory, so it can be parsed in place
+	class Mapped_file {
+	  public:
+		explicit Mapped_file(const std::string& path);
+		~Mapped_file();
+
+		Mapped_file(const Mapped_file&) = delete;
+		Mapped_file& operator=(const Mapped_file&) = delete;
+
+		auto valid() const noexcept { return _valid; }
+		auto view() const noexcept { return std::string_view(_data, _size); }
+
+	  private:
+		const char* _data  = nullptr;
+		std::size_t _size  = 0;
+		bool        _valid = false;
+
+#ifdef _WIN32
+		HANDLE _file    = INVALID_HANDLE_VALUE;
+		HANDLE _mapping = nullptr;
+#endif
+	};
+
+
+#ifdef _WIN32
+	inline Mapped_file::Mapped_file(const std::string& path)
+	{
+		_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		                    FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if(_file == INVALID_HANDLE_VALUE)
+			return;
+
+		auto size = LARGE_INTEGER{};
+		if(!GetFileSizeEx(_file, &size))
+			return;
+
+		if(size.QuadPart == 0) {
+			_valid = true; // empty files can't be mapped
+			return;
+		}
+
+		_mapping = CreateFileMappingA(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if(!_mapping)
+			return;
+
+		_data  = static_cast<const char*>(MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0));
+		_size  = _data ? static_cast<std::size_t>(size.QuadPart) : 0;
+		_valid = _data != nullptr;
+	}
+	inline Mapped_file::~Mapped_file()
+	{
+		if(_data)
+			UnmapViewOfFile(_data);
+		if(_mapping)
+			CloseHandle(_mapping);
+		if(_file != INVALID_HANDLE_VALUE)
+			CloseHandle(_file);
+	}
+
+#else
+	inline Mapped_file::Mapped_file(const std::string& path)
+	{
+		auto fd = ::open(path.c_str(), O_RDONLY);
+		if(fd < 0)
+			return;
+
+		struct stat info;
+		if(::fstat(fd, &info) != 0) {
+			::close(fd);
+			return;
+		}
+
+		auto size = static_cast<std::size_t>(info.st_size);
+		if(size == 0) {
+			::close(fd);
+			_valid = true; // empty files can't be mapped
+			return;
+		}
+
+		auto addr = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		::close(fd); // the mapping keeps its own reference to the file
+
+		if(addr == MAP_FAILED)
+			return;
+
+		::madvise(addr, size, MADV_SEQUENTIAL);
+
+		_data  = static_cast<const char*>(addr);
+		_size  = size;
+		_valid = true;
+	}
+	inline Mapped_file::~Mapped_file()
+	{
+		if(_data)
+			::munmap(const_cast<char*>(_data), _size);
+	}
+#endif
+
+} // namespace sf2
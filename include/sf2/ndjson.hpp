@@ -0,0 +1,120 @@
+/***********************************************************\
+ * Newline delimited JSON (JSON Lines)                     *
+ *     ___________ _____                                   *
+ *    /  ___|  ___/ __  \                                  *
+ *    \ `--.| |_  `' / /'                                  *
+ *     `--. \  _|   / /                                    *
+ *    /\__/ / |   ./ /___                                  *
+ *    \____/\_|   \_____/                                  *
+ *                                                         *
+ *                                                         *
+ *  Copyright (c) 2014 Florian Oetke                       *
+ *                                                         *
+ *  This file is part of SF2 and distributed under         *
+ *  the MIT License. See LICENSE file for details.         *
+\***********************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <ostream>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "parallel.hpp"
+#include "serializer.hpp"
+#include "formats/json_reader.hpp"
+#include "formats/json_writer.hpp"
+
+namespace sf2 {
+
+	// writes the record as a single line
+	template<class T>
+	inline void serialize_ndjson(std::ostream& stream, const T& record) {
+		Serializer<format::Json_writer>{format::Json_writer{stream, format::Json_style::compact}}.write(record);
+	}
+
+	namespace details {
+		struct Ndjson_record {
+			std::string_view text;
+			std::uint32_t    row;
+		};
+
+		// one record per line, lines that only contain whitespace are skipped
+		inline auto split_ndjson(std::string_view buffer) -> std::vector<Ndjson_record> {
+			auto records = std::vector<Ndjson_record>();
+			records.reserve(buffer.size() / 128);
+
+			auto row = std::uint32_t(1);
+			for(auto begin=buffer.data(), end=begin+buffer.size(); begin!=end; row++) {
+				auto line_end = static_cast<const char*>(std::memchr(begin, '\n', static_cast<std::size_t>(end-begin)));
+				if(!line_end)
+					line_end = end;
+
+				auto line = std::string_view(begin, static_cast<std::size_t>(line_end-begin));
+				if(line.find_first_not_of(" \t\r")!=std::string_view::npos)
+					records.push_back(Ndjson_record{line, row});
+
+				begin = line_end==end ? end : line_end+1;
+			}
+
+			return records;
+		}
+
+		template<class T>
+		void read_ndjson_record(const Ndjson_record& record, T& out, const format::Error_handler& ehandler,
+		                        std::mutex& error_mutex) {
+			auto handler = format::Error_handler{};
+			if(ehandler) {
+				handler = [&](auto& msg, std::uint32_t, std::uint32_t column) {
+					auto lock = std::lock_guard<std::mutex>{error_mutex};
+					ehandler(msg, record.row, column);
+				};
+			}
+
+			Deserializer<format::Json_reader>{format::Json_reader{record.text, handler}, handler}.read_value(out);
+		}
+	}
+
+	/*
+	 * Deserializes all records of a newline delimited JSON buffer on the given number of threads
+	 * and returns them in the order of the input.
+	 * The error handler may be called from any thread, but never concurrently. Rows are the line numbers.
+	 */
+	template<class T>
+	auto deserialize_ndjson(std::string_view buffer, unsigned threads=std::thread::hardware_concurrency(),
+	                        format::Error_handler ehandler=format::Error_handler{}) -> std::vector<T> {
+		auto records = details::split_ndjson(buffer);
+		auto result = std::vector<T>(records.size());
+		auto error_mutex = std::mutex{};
+
+		details::parallel_for(records.size(), threads, 64, [&](std::size_t i) {
+			details::read_ndjson_record(records[i], result[i], ehandler, error_mutex);
+		});
+
+		return result;
+	}
+
+	/*
+	 * Like deserialize_ndjson, but passes each record to callback(std::size_t index, T&& record)
+	 * as soon as it has been deserialized instead of collecting them.
+	 * The callback is called from the worker threads and has to be thread-safe.
+	 */
+	template<class T, class Callback>
+	void deserialize_ndjson_unordered(std::string_view buffer, Callback&& callback,
+	                                  unsigned threads=std::thread::hardware_concurrency(),
+	                                  format::Error_handler ehandler=format::Error_handler{}) {
+		auto records = details::split_ndjson(buffer);
+		auto error_mutex = std::mutex{};
+
+		details::parallel_for(records.size(), threads, 64, [&](std::size_t i) {
+			auto record = T();
+			details::read_ndjson_record(records[i], record, ehandler, error_mutex);
+			callback(i, std::move(record));
+		});
+	}
+
+}
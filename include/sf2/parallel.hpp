@@ -0,0 +1,78 @@
+/***********************************************************\
+ * Helpers for multi-threaded deserialization              *
+ *     ___________ _____                                   *
+ *    /  ___|  ___/ __  \                                  *
+ *    \ `--.| |_  `' / /'                                  *
+ *     `--. \  _|   / /                                    *
+ *    /\__/ / |   ./ /___                                  *
+ *    \____/\_|   \_____/                                  *
+ *                                                         *
+ *                                                         *
+ *  Copyright (c) 2014 Florian Oetke                       *
+ *                                                         *
+ *  This file is part of SF2 and distributed under         *
+ *  the MIT License. See LICENSE file for details.         *
+\***********************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <thread>
+#include <vector>
+
+namespace sf2 {
+namespace details {
+
+	// joins all threads when it goes out of scope, so no thread outlives the data it references
+	struct Join_guard {
+		std::vector<std::thread>& threads;
+
+		~Join_guard() {
+			for(auto& t : threads)
+				if(t.joinable())
+					t.join();
+		}
+	};
+
+	// calls func(i) for every i in [0, count) on the calling and up to threads-1 additional threads.
+	// Indices are handed out in batches of batch_size, to balance the load without much contention.
+	// If func throws, the remaining batches are skipped and the first exception is rethrown after all threads joined
+	template<class Func>
+	void parallel_for(std::size_t count, unsigned threads, std::size_t batch_size, Func&& func) {
+		auto next = std::atomic<std::size_t>{0};
+		auto failed = std::atomic<bool>{false};
+		auto error = std::exception_ptr();
+		auto work = [&] {
+			try {
+				for(auto begin=next.fetch_add(batch_size); begin<count; begin=next.fetch_add(batch_size)) {
+					auto end = std::min(begin+batch_size, count);
+					for(auto i=begin; i<end; i++)
+						func(i);
+				}
+			} catch(...) {
+				if(!failed.exchange(true))
+					error = std::current_exception();
+				next = count;
+			}
+		};
+
+		auto batches = (count + batch_size - 1) / batch_size;
+		auto workers = std::vector<std::thread>();
+		{
+			auto guard = Join_guard{workers};
+			workers.reserve(std::min<std::size_t>(threads, batches));
+			for(auto i=1u; i<std::min<std::size_t>(threads, batches); i++)
+				workers.emplace_back(work);
+
+			work();
+		}
+
+		if(error)
+			std::rethrow_exception(error);
+	}
+
+}
+}
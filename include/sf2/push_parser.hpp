@@ -0,0 +1,242 @@
+/***********************************************************\
+ * Incremental parser for chunked input                    *
+ *     ___________ _____                                   *
+ *    /  ___|  ___/ __  \                                  *
+ *    \ `--.| |_  `' / /'                                  *
+ *     `--. \  _|   / /                                    *
+ *    /\__/ / |   ./ /___                                  *
+ *    \____/\_|   \_____/                                  *
+ *                                                         *
+ *                                                         *
+ *  Copyright (c) 2014 Florian Oetke                       *
+ *                                                         *
+ *  This file is part of SF2 and distributed under         *
+ *  the MIT License. See LICENSE file for details.         *
+\***********************************************************/
+
+#pragma once
+
+#include <cctype>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+
+#include "serializer.hpp"
+#include "formats/json_reader.hpp"
+#include "formats/simd.hpp"
+
+namespace sf2 {
+
+	/*
+	 * Accepts a sequence of JSON documents in chunks of arbitrary size (e.g. as received from a socket)
+	 * and never blocks. Each chunk is only scanned for the end of the current document, which can be
+	 * interrupted at any byte. Complete documents are deserialized by read():
+	 *   parser.feed(chunk);
+	 *   while(parser.ready()) parser.read(message);
+	 * Only incomplete documents are buffered. std::string_view members reference that buffer and are
+	 * invalidated by the next call to feed().
+	 */
+	class Push_parser {
+		public:
+			Push_parser() = default;
+
+			void feed(std::string_view chunk);
+
+			// no more input will follow, so a pending top-level number or literal is complete
+			// and incomplete documents can be read to report them as errors
+			void finish();
+
+			// a complete document is available
+			auto ready()const noexcept {return !_ends.empty();}
+
+			// number of bytes that are buffered, but not read yet
+			auto buffered()const noexcept {return _buffer.size() - _begin;}
+
+			// deserializes the next complete document, returns false if there is none
+			template<class T>
+			bool read(T& out, format::Error_handler ehandler=format::Error_handler{});
+
+		private:
+			enum class Comment : std::uint8_t {
+				none, slash, body, star
+			};
+
+			std::string             _buffer;
+			std::size_t             _begin = 0; // begin of the next unread document
+			std::size_t             _scan = 0;  // everything before has already been scanned
+			std::deque<std::size_t> _ends;
+
+			int     _depth = 0;
+			bool    _in_string = false;
+			bool    _escaped = false;
+			bool    _in_scalar = false;
+			bool    _in_document = false;
+			Comment _comment = Comment::none;
+
+			void _scan_buffer();
+			void _complete(std::size_t end);
+	};
+
+
+	inline void Push_parser::feed(std::string_view chunk) {
+		if(_begin>0) {
+			_buffer.erase(0, _begin);
+			_scan -= _begin;
+			for(auto& e : _ends)
+				e -= _begin;
+			_begin = 0;
+		}
+
+		_buffer.append(chunk.data(), chunk.size());
+		_scan_buffer();
+	}
+
+	inline void Push_parser::finish() {
+		if(_in_document)
+			_complete(_buffer.size());
+	}
+
+	inline void Push_parser::_complete(std::size_t end) {
+		_ends.push_back(end);
+		_depth = 0;
+		_in_string = false;
+		_escaped = false;
+		_in_scalar = false;
+		_in_document = false;
+		_comment = Comment::none;
+	}
+
+	inline void Push_parser::_scan_buffer() {
+		const char* begin = _buffer.data();
+		auto end = begin + _buffer.size();
+		auto p = begin + _scan;
+
+		while(p!=end) {
+			if(_comment!=Comment::none) {
+				if(_comment==Comment::slash) {
+					// not a comment, which is reported by the reader
+					_comment = *p=='*' ? Comment::body : Comment::none;
+					if(_comment==Comment::body)
+						p++;
+					continue;
+				}
+
+				auto c = *p++;
+				if(_comment==Comment::star && c=='/')
+					_comment = Comment::none;
+				else
+					_comment = c=='*' ? Comment::star : Comment::body;
+				continue;
+			}
+
+			if(_escaped) {
+				_escaped = false;
+				p++;
+				continue;
+			}
+
+			if(_in_string) {
+				p = format::details::find_string_special(p, end);
+				if(p==end)
+					break;
+
+				auto c = *p++;
+				if(c=='\\') {
+					_escaped = true;
+				} else if(c=='"') {
+					_in_string = false;
+					if(_depth==0)
+						_complete(static_cast<std::size_t>(p-begin));
+				}
+				continue;
+			}
+
+			if(_depth>0) {
+				p = format::details::find_structure_special(p, end);
+				if(p==end)
+					break;
+
+				switch(*p++) {
+					case '{':
+					case '[':
+						_depth++;
+						break;
+					case '}':
+					case ']':
+						if(--_depth==0)
+							_complete(static_cast<std::size_t>(p-begin));
+						break;
+					case '"':
+						_in_string = true;
+						break;
+					case '/':
+						_comment = Comment::slash;
+						break;
+					default:
+						break;
+				}
+				continue;
+			}
+
+			// between documents or inside a top-level number/literal
+			auto c = *p;
+			auto delimiter = !std::isgraph(static_cast<unsigned char>(c)) || c=='{' || c=='[' || c=='"' || c=='/';
+			if(_in_scalar) {
+				if(delimiter)
+					_complete(static_cast<std::size_t>(p-begin));
+				else
+					p++;
+				continue;
+			}
+
+			p++;
+			switch(c) {
+				case '{':
+				case '[':
+					_depth = 1;
+					_in_document = true;
+					break;
+				case '"':
+					_in_string = true;
+					_in_document = true;
+					break;
+				case '/':
+					_comment = Comment::slash;
+					break;
+				default:
+					if(!delimiter) {
+						_in_scalar = true;
+						_in_document = true;
+					}
+					break;
+			}
+		}
+
+		_scan = static_cast<std::size_t>(p-begin);
+	}
+
+	template<class T>
+	bool Push_parser::read(T& out, format::Error_handler ehandler) {
+		if(_ends.empty())
+			return false;
+
+		auto end = _ends.front();
+		auto document = std::string_view(_buffer).substr(_begin, end-_begin);
+		_ends.pop_front();
+		_begin = end;
+
+		auto failed = false;
+		auto handler = format::Error_handler{};
+		if(ehandler) {
+			handler = [&](auto& msg, std::uint32_t row, std::uint32_t column) {
+				failed = true;
+				ehandler(msg, row, column);
+			};
+		}
+
+		Deserializer<format::Json_reader>{format::Json_reader{document, handler}, handler}.read_value(out);
+		return !failed;
+	}
+
+}
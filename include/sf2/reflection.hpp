@@ -307,10 +307,10 @@ namespace sf2 {}
 
 #define sf2_enumDef(TYPE, ...) SF2_PRE_DEF inline auto& sf2_enum_info_factory(TYPE*) {\
 	using sf2_current_type = TYPE;\
-	static auto data = ::sf2::Enum_info<TYPE>{\
+	static constexpr auto data = ::sf2::make_enum_info<TYPE>(\
 			::sf2::String_literal{#TYPE}, \
-			{SF2_APPLY(SF2_EXTRACT_VALUE,__VA_ARGS__)}\
-	};\
+			SF2_APPLY(SF2_EXTRACT_VALUE,__VA_ARGS__)\
+	);\
 	return data;\
 } auto& sf2_enum_info_factory(TYPE*) SF2_POST_DEF
 
@@ -18,9 +18,14 @@
 
 #include <array>
 #include <cassert>
-#include <map>
+#include <cstdint>
+#include <initializer_list>
+#include <limits>
 #include <string>
-#include <unordered_map>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 #include <iostream>
 
@@ -58,7 +63,7 @@ namespace sf2 {
 		  : data(str.data()), len(str.size()), hash(details::calc_hash(data, len))
 		{
 		}
-		String_literal(const std::string_view& str)
+		constexpr String_literal(const std::string_view& str)
 		  : data(str.data()), len(str.size()), hash(details::calc_hash(data, len))
 		{
 		}
@@ -66,7 +71,7 @@ namespace sf2 {
 
 		auto str() const -> std::string { return std::string(data, len); }
 
-		bool operator==(const String_literal& rhs) const
+		constexpr bool operator==(const String_literal& rhs) const
 		{
 			if(len != rhs.len) {
 				return false;
@@ -103,52 +108,283 @@ namespace std {
 } // namespace std
 
 namespace sf2 {
-	template <typename T>
+	namespace details {
+		constexpr auto key_table_size(std::size_t keys) noexcept -> std::size_t
+		{
+			auto size = std::size_t(2);
+			while(size < keys * 2)
+				size *= 2;
+			return size;
+		}
+
+		/*
+		 * Hash table from names to their index, that can be built at compile time.
+		 * Slots are found by a multiplicative hash and collisions are resolved by linear probing.
+		 * Of the tried multipliers the one with the fewest collisions is used, which avoids them
+		 * completely for small structs. A lookup of a name without collision costs one
+		 * multiplication and one comparison.
+		 */
+		template <std::size_t N>
+		class Key_table {
+		  public:
+			constexpr Key_table(const std::array<String_literal, N>& keys) : _keys(keys)
+			{
+				auto best_seed       = std::size_t(1);
+				auto best_collisions = N + 1;
+				for(std::size_t attempt = 0; attempt < 256 && best_collisions > 0; ++attempt) {
+					_seed           = std::size_t(0x9E3779B97F4A7C15ULL) * (2 * attempt + 1);
+					auto collisions = _collisions();
+					if(collisions < best_collisions) {
+						best_seed       = _seed;
+						best_collisions = collisions;
+					}
+				}
+				_seed = best_seed;
+
+				for(std::size_t i = 0; i < N; ++i) {
+					_lengths |= _length_bit(_keys[i].len);
+
+					auto slot = _slot(_keys[i].hash);
+					while(_table[slot] != 0)
+						slot = (slot + 1) % size;
+
+					_table[slot] = static_cast<std::uint16_t>(i + 1);
+				}
+			}
+
+			// index of the name or -1
+			constexpr auto find(const String_literal& key) const noexcept -> int
+			{
+				for(auto slot = _slot(key.hash); _table[slot] != 0; slot = (slot + 1) % size) {
+					auto i = _table[slot] - 1;
+					if(_keys[i] == key)
+						return i;
+				}
+				return -1;
+			}
+			// same for a key read from the input, that is only hashed if a name has the same length
+			constexpr auto find_key(std::string_view key) const noexcept -> int
+			{
+				if((_lengths & _length_bit(key.size())) == 0)
+					return -1;
+				return find(String_literal{key});
+			}
+
+		  private:
+			static constexpr auto size = key_table_size(N);
+			static constexpr auto shift = [] {
+				auto bits = 0;
+				for(auto s = size; s > 1; s /= 2)
+					bits++;
+				return std::numeric_limits<std::size_t>::digits - bits;
+			}();
+
+			std::array<String_literal, N>   _keys;
+			std::array<std::uint16_t, size> _table{};
+			std::size_t                     _seed = 1;
+			std::uint64_t                   _lengths = 0; // bit per name length, the last one for all longer names
+
+			constexpr auto _slot(std::size_t hash) const noexcept -> std::size_t
+			{
+				return (hash * _seed) >> shift;
+			}
+			static constexpr auto _length_bit(std::size_t len) noexcept -> std::uint64_t
+			{
+				return std::uint64_t(1) << (len < 63 ? len : 63);
+			}
+			// number of names whose slot is already used by another one
+			constexpr auto _collisions() const noexcept -> std::size_t
+			{
+				bool used[size]{};
+				auto collisions = std::size_t(0);
+				for(std::size_t i = 0; i < N; ++i) {
+					auto slot = _slot(_keys[i].hash);
+					if(used[slot])
+						collisions++;
+					used[slot] = true;
+				}
+				return collisions;
+			}
+		};
+	} // namespace details
+} // namespace sf2
+
+namespace sf2 {
+	// size of an Enum_info, whose values are only known at runtime
+	constexpr auto dynamic_enum_size = std::numeric_limits<std::size_t>::max();
+
+	/*
+	 * Names and values of an enum, that are built at compile time.
+	 * name_of is an array lookup if the values are contiguous and a binary search otherwise,
+	 * value_of uses the same hash table as Struct_info.
+	 */
+	template <typename T, std::size_t N = dynamic_enum_size>
 	class Enum_info {
 	  public:
 		using Value_type = std::pair<T, String_literal>;
+		static constexpr std::size_t value_count = N;
 
 	  public:
-		Enum_info(String_literal name, std::initializer_list<Value_type> v) : _name(name)
+		constexpr Enum_info(String_literal name, const std::array<Value_type, N>& v)
+		  : _name(name), _values(v), _key_table(_names(v, std::make_index_sequence<N>{}))
 		{
-			for(auto& e : v) {
-				_names.emplace(e.first, e.second);
-				_values.emplace(e.second, e.first);
+			for(std::size_t i = 0; i < N; ++i)
+				_sorted[i] = Sorted_value{static_cast<Underlying>(v[i].first), i};
+
+			// insertion sort, because std::sort isn't constexpr
+			for(std::size_t i = 1; i < N; ++i) {
+				for(auto j = i; j > 0 && _sorted[j].value < _sorted[j - 1].value; --j) {
+					auto tmp       = _sorted[j];
+					_sorted[j]     = _sorted[j - 1];
+					_sorted[j - 1] = tmp;
+				}
+			}
+
+			_dense = N > 0;
+			for(std::size_t i = 1; i < N; ++i) {
+				if(_sorted[i].value != _sorted[i - 1].value + 1)
+					_dense = false;
 			}
 		}
 
-		auto name() const noexcept { return _name; }
+		constexpr auto  name() const noexcept { return _name; }
+		constexpr auto& values() const noexcept { return _values; }
 
-		auto value_of(const String_literal& name) const noexcept -> T
+		// returns false if there is no value with the given name
+		constexpr bool try_value_of(const String_literal& name, T& value) const noexcept
 		{
-			auto i = _values.find(name);
-			assert(i != _values.end());
-			return i->second;
+			auto i = _key_table.find(name);
+			if(i < 0)
+				return false;
+
+			value = _values[static_cast<std::size_t>(i)].first;
+			return true;
 		}
-		auto value_of(const std::string& name) const noexcept -> T
+		// returns false if the value has no name
+		constexpr bool valid(T value) const noexcept { return _index_of(value) < N; }
+
+		constexpr auto value_of(const String_literal& name) const noexcept -> T
 		{
-			auto i = _values.find(String_literal{name});
-			assert(i != _values.end());
-			return i->second;
+			auto i = _key_table.find(name);
+			assert(i >= 0);
+			return _values[static_cast<std::size_t>(i)].first;
 		}
+		auto value_of(const std::string& name) const noexcept -> T { return value_of(String_literal{name}); }
 
-		auto name_of(T value) const noexcept -> String_literal
+		constexpr auto name_of(T value) const noexcept -> String_literal
 		{
-			auto i = _names.find(value);
-			assert(i != _names.end());
-			return i->second;
+			auto i = _index_of(value);
+			assert(i < N);
+			return i < N ? _values[i].second : String_literal{""};
 		}
 
 	  private:
-		struct Enum_hash {
-			auto operator()(T v) const { return static_cast<std::size_t>(v); }
+		using Underlying = std::underlying_type_t<T>;
+
+		struct Sorted_value {
+			Underlying  value = 0;
+			std::size_t index = 0;
 		};
 
-		String_literal                                   _name;
-		std::unordered_map<T, String_literal, Enum_hash> _names;
-		std::unordered_map<String_literal, T>            _values;
+		String_literal                   _name;
+		std::array<Value_type, N>        _values;
+		std::array<Sorted_value, N>      _sorted{};
+		bool                             _dense = false;
+		details::Key_table<N>            _key_table;
+
+		template <std::size_t... I>
+		static constexpr auto _names(const std::array<Value_type, N>& v, std::index_sequence<I...>)
+		{
+			return std::array<String_literal, N>{{v[I].second...}};
+		}
+
+		// index into _values or N
+		constexpr auto _index_of(T value) const noexcept -> std::size_t
+		{
+			auto v = static_cast<Underlying>(value);
+
+			if(_dense) {
+				if(v < _sorted[0].value || v > _sorted[N - 1].value)
+					return N;
+				return _sorted[static_cast<std::size_t>(v - _sorted[0].value)].index;
+			}
+
+			auto begin = std::size_t(0);
+			auto end   = N;
+			while(begin < end) {
+				auto mid = begin + (end - begin) / 2;
+				if(_sorted[mid].value < v)
+					begin = mid + 1;
+				else
+					end = mid;
+			}
+			return begin < N && _sorted[begin].value == v ? _sorted[begin].index : N;
+		}
 	};
 
+	/*
+	 * Enum_info that is built at runtime, with linear lookups. Only kept for hand-written
+	 * sf2_enum_info_factory functions, e.g. static auto data = Enum_info<E>{"E", {{E::a, "a"}}};
+	 */
+	template <typename T>
+	class Enum_info<T, dynamic_enum_size> {
+	  public:
+		using Value_type = std::pair<T, String_literal>;
+
+	  public:
+		Enum_info(String_literal name, std::initializer_list<Value_type> v) : _name(name), _values(v) {}
+
+		auto  name() const noexcept { return _name; }
+		auto& values() const noexcept { return _values; }
+
+		bool try_value_of(const String_literal& name, T& value) const noexcept
+		{
+			for(auto& v : _values) {
+				if(v.second == name) {
+					value = v.first;
+					return true;
+				}
+			}
+			return false;
+		}
+		bool valid(T value) const noexcept { return _index_of(value) < _values.size(); }
+
+		auto value_of(const String_literal& name) const noexcept -> T
+		{
+			auto value = T{};
+			auto found = try_value_of(name, value);
+			assert(found);
+			(void) found;
+			return value;
+		}
+		auto value_of(const std::string& name) const noexcept -> T { return value_of(String_literal{name}); }
+
+		auto name_of(T value) const noexcept -> String_literal
+		{
+			auto i = _index_of(value);
+			assert(i < _values.size());
+			return i < _values.size() ? _values[i].second : String_literal{""};
+		}
+
+	  private:
+		String_literal          _name;
+		std::vector<Value_type> _values;
+
+		auto _index_of(T value) const noexcept -> std::size_t
+		{
+			auto i = std::size_t(0);
+			while(i < _values.size() && _values[i].first != value)
+				i++;
+			return i;
+		}
+	};
+
+	template <typename T, typename... Values>
+	constexpr auto make_enum_info(String_literal name, Values... values)
+	{
+		return Enum_info<T, sizeof...(Values)>{name, {{values...}}};
+	}
+
 
 	template <typename ST, typename MT>
 	using Member_ptr = MT ST::*;
@@ -162,7 +398,10 @@ namespace sf2 {
 		static constexpr std::size_t member_count = sizeof...(MemberT);
 
 		constexpr Struct_info(String_literal name, Member_data<T, MemberT>... members)
-		  : _name(name), _member_names{{std::get<1>(members)...}}, _members(std::get<0>(members)...)
+		  : _name(name)
+		  , _member_names{{std::get<1>(members)...}}
+		  , _members(std::get<0>(members)...)
+		  , _key_table(_member_names)
 		{
 		}
 
@@ -171,6 +410,10 @@ namespace sf2 {
 		constexpr auto& member_ptrs() const { return _members; }
 		constexpr auto  size() const { return member_count; }
 
+		// index of the member with the given name or -1
+		constexpr auto index_of(const String_literal& name) const noexcept { return _key_table.find(name); }
+		constexpr auto index_of_key(std::string_view key) const noexcept { return _key_table.find_key(key); }
+
 
 		template <std::size_t I = 0, typename FuncT>
 		inline typename std::enable_if<I == member_count, void>::type for_each(FuncT) const
@@ -188,6 +431,7 @@ namespace sf2 {
 		String_literal                           _name;
 		std::array<String_literal, member_count> _member_names;
 		std::tuple<Member_ptr<T, MemberT>...>    _members;
+		details::Key_table<member_count>         _key_table;
 	};
 
 
@@ -16,13 +16,26 @@
 
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <cstdint>
 #include <functional>
+#include <iterator>
+#include <limits>
 #include <memory>
+#include <mutex>
 #include <iostream>
 #include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
 #include <variant>
+#include <vector>
 
+#include "parallel.hpp"
 #include "reflection_data.hpp"
+#include "static_vector.hpp"
 
 namespace sf2 {
 
@@ -127,6 +140,36 @@ namespace sf2 {
 				enum { value = sizeof(test<T>(nullptr)) == sizeof(char) };
 		};
 
+		// ordered associative containers, that can be filled efficiently from sorted input with end() as hint
+		template<class T>
+		struct has_key_compare {
+			private:
+				typedef char one;
+				typedef long two;
+
+				template <typename C> static one test(typename C::key_compare*);
+				template <typename C> static two test(...);
+
+
+			public:
+				enum { value = sizeof(test<T>(nullptr)) == sizeof(char) };
+		};
+
+		template<class T>
+		struct has_try_emplace {
+			private:
+				typedef char one;
+				typedef long two;
+
+				template <typename C> static one test(decltype(std::declval<C&>().try_emplace(
+				                                          std::declval<typename C::key_type>()))*);
+				template <typename C> static two test(...);
+
+
+			public:
+				enum { value = sizeof(test<T>(nullptr)) == sizeof(char) };
+		};
+
 		template<class T>
 		struct is_map {
 			enum { value = is_range<T>::value &&
@@ -145,6 +188,128 @@ namespace sf2 {
 			               !has_key_type<T>::value &&
 			               !has_mapped_type<T>::value };
 		};
+
+		// vectors whose elements can be written concurrently
+		template<class T>
+		struct is_parallel_vector : std::false_type {};
+		template<class T, class A>
+		struct is_parallel_vector<std::vector<T,A>> : std::negation<std::is_same<T, bool>> {};
+
+		// arrays with a size that is fixed at compile time, whose elements are always overwritten
+		template<class T>
+		struct is_fixed_array : std::false_type {};
+		template<class T, std::size_t N>
+		struct is_fixed_array<std::array<T,N>> : std::true_type {};
+		template<class T, std::size_t N>
+		struct is_fixed_array<T[N]> : std::true_type {};
+
+		template<class T>
+		struct is_static_vector : std::false_type {};
+		template<class T, std::size_t N>
+		struct is_static_vector<static_vector<T,N>> : std::true_type {};
+
+		// the 64 bit integer type with the signedness of T
+		template<class T>
+		using Widened_integer = std::conditional_t<std::is_signed<T>::value, std::int64_t, std::uint64_t>;
+
+		// vectors of numbers, that readers may parse in bulk
+		template<class T>
+		struct is_number_vector : std::false_type {};
+		template<class T, class A>
+		struct is_number_vector<std::vector<T,A>>
+		        : std::bool_constant<std::is_arithmetic<T>::value && !std::is_same<T, bool>::value> {};
+
+		template<class Reader, class T>
+		struct can_read_numbers {
+			private:
+				typedef char one;
+				typedef long two;
+
+				template <typename C> static one test(decltype(std::declval<C&>().read_numbers(std::declval<T&>()))*);
+				template <typename C> static two test(...);
+
+
+			public:
+				enum { value = is_number_vector<T>::value && sizeof(test<Reader>(nullptr)) == sizeof(char) };
+		};
+
+		// readers that can split arrays into the text of their elements, that are read by a Slice_reader
+		template<class Reader>
+		struct can_split_arrays {
+			private:
+				typedef char one;
+				typedef long two;
+
+				template <typename C> static one test(decltype(std::declval<C&>().read_remaining_array_elements(
+				                                          std::declval<std::vector<std::string_view>&>()))*,
+				                                      typename C::Slice_reader* = nullptr);
+				template <typename C> static two test(...);
+
+
+			public:
+				enum { value = sizeof(test<Reader>(nullptr)) == sizeof(char) };
+		};
+
+		// readers that can estimate the size of arrays and objects before reading them
+		template<class Reader>
+		struct has_size_hints {
+			private:
+				typedef char one;
+				typedef long two;
+
+				template <typename C> static one test(decltype(std::declval<C&>().array_size_hint())*);
+				template <typename C> static two test(...);
+
+
+			public:
+				enum { value = sizeof(test<Reader>(nullptr)) == sizeof(char) };
+		};
+
+		template<class T>
+		struct has_reserve {
+			private:
+				typedef char one;
+				typedef long two;
+
+				template <typename C> static one test(decltype(std::declval<C&>().reserve(std::size_t(0)))*);
+				template <typename C> static two test(...);
+
+
+			public:
+				enum { value = sizeof(test<T>(nullptr)) == sizeof(char) };
+		};
+
+		// readers that can return object keys without copying them
+		template<class Reader>
+		struct has_read_key {
+			private:
+				typedef char one;
+				typedef long two;
+
+				template <typename C> static one test(decltype(std::declval<C&>().read_key(
+				                                          std::declval<std::string&>()))*);
+				template <typename C> static two test(...);
+
+
+			public:
+				enum { value = sizeof(test<Reader>(nullptr)) == sizeof(char) };
+		};
+
+		// readers that report errors of the Deserializer through their own error policy
+		template<class Reader>
+		struct has_on_error {
+			private:
+				typedef char one;
+				typedef long two;
+
+				template <typename C> static one test(decltype(std::declval<C&>().on_error(
+				                                          std::declval<const std::string&>()))*);
+				template <typename C> static two test(...);
+
+
+			public:
+				enum { value = sizeof(test<Reader>(nullptr)) == sizeof(char) };
+		};
 	}
 
 	template<typename T>
@@ -193,8 +358,38 @@ namespace sf2 {
 			writer.end_current();
 		}
 
+		// writes a top-level array incrementally, one element at a time:
+		//   begin_array(); for(...) write_element(v); end_array();
+		void begin_array() {
+			writer.begin_array();
+		}
+		template<class T>
+		void write_element(const T& inst) {
+			write_value(inst);
+		}
+		void end_array() {
+			writer.end_current();
+		}
+
+		// annotated enums are written as their integer value instead of their name,
+		// the Deserializer accepts both. Keys of maps are always written as names
+		void enums_as_integers(bool integers) {
+			enum_integers = integers;
+		}
+
 		private:
 			Writer writer;
+			bool enum_integers = false;
+
+			template<class T>
+			void write_key(const T& inst) {
+				if constexpr(is_annotated_enum<T>::value && !details::has_save<Writer,T>::value) {
+					auto name = get_enum_info<T>().name_of(inst);
+					writer.write(name.data, name.len);
+				} else {
+					write_value(inst);
+				}
+			}
 
 			template<class K, class T>
 			int write_member_pair(std::pair<K, T&> inst) {
@@ -218,7 +413,7 @@ namespace sf2 {
 		public:
 			template<class T>
 			std::enable_if_t<!details::has_save<Writer,T*>::value>
-			  write_value(const T* inst) {
+			  write_value(const T* const& inst) { // by reference, so C arrays don't decay to it
 				if(inst)
 					write_value(*inst);
 				else
@@ -259,8 +454,12 @@ namespace sf2 {
 			template<class T>
 			std::enable_if_t<is_annotated_enum<T>::value && !details::has_save<Writer,T>::value>
 			  write_value(const T& inst) {
-				auto name = get_enum_info<T>().name_of(inst);
-				writer.write(name.data, name.len);
+				if(enum_integers) {
+					writer.write(static_cast<details::Widened_integer<std::underlying_type_t<T>>>(inst));
+				} else {
+					auto name = get_enum_info<T>().name_of(inst);
+					writer.write(name.data, name.len);
+				}
 			}
 
 			// map
@@ -273,7 +472,7 @@ namespace sf2 {
 				writer.begin_obj();
 
 				for(auto& v : inst) {
-					write_value(v.first);
+					write_key(v.first);
 					write_value(v.second);
 				}
 
@@ -330,6 +529,9 @@ namespace sf2 {
 			void write_value(const std::string& inst) {
 				writer.write(inst);
 			}
+			void write_value(std::string_view inst) {
+				writer.write(inst);
+			}
 			void write_value(const char* inst) {
 				writer.write(inst);
 			}
@@ -353,6 +555,8 @@ namespace sf2 {
 	struct Deserializer {
 		Reader reader;
 			
+		template<typename> friend struct Deserializer;
+
 		Deserializer(Reader&& r, Error_handler error_handler=Error_handler())
 		    : reader(std::move(r)), error_handler(error_handler) {
 			buffer.reserve(64);
@@ -361,26 +565,7 @@ namespace sf2 {
 		template<class T>
 		std::enable_if_t<is_annotated_struct<T>::value && !details::has_load<Reader,T>::value>
 		  read(T& inst) {
-
-			while(reader.in_obj()) {
-				reader.read(buffer);
-
-				auto match = false;
-				auto key = String_literal{buffer};
-
-				get_struct_info<T>().for_each([&](String_literal n, auto mptr) {
-					if(!match && n==key) {
-						this->read_value(inst.*mptr);
-						match = true;
-					}
-				});
-
-				if(!match) {
-					on_error("Unexpected key "+buffer);
-				}
-			}
-
-			details::call_post_load(inst);
+			read_struct(inst);
 		}
 
 		// manual load-function
@@ -394,17 +579,16 @@ namespace sf2 {
 
 		template<typename... Members>
 		inline void read_virtual(Members&&... m) {
-			while(reader.in_obj()) {
-				reader.read(buffer);
-
-				bool match = false;
-				auto key = String_literal{buffer};
+			// the names are only known at runtime, so the table is built once per object instead of per key
+			auto keys = details::Key_table<sizeof...(Members)>{{{String_literal{m.first}...}}};
 
-				auto i = {read_member_pair(match, key, m)...};
-				(void)i;
+			while(reader.in_obj()) {
+				auto key = read_key();
 
-				if(!match) {
-					on_error("Unexpected key "+buffer);
+				auto index = keys.find_key(key);
+				if(index<0 || !read_member_pair(static_cast<std::size_t>(index),
+				                                std::index_sequence_for<Members...>{}, m...)) {
+					on_unknown_key(key);
 				}
 			}
 		}
@@ -417,29 +601,183 @@ namespace sf2 {
 				bool match = func(buffer);
 
 				if(!match) {
-					on_error("Unexpected key "+buffer);
+					on_unknown_key(buffer);
 				}
 			}
 		}
 
+		// skip the values of unknown keys silently instead of reporting them as errors
+		void ignore_unknown_keys(bool ignore) {
+			ignore_unknown = ignore;
+		}
+
+		// std::vectors with more than min_elements elements are deserialized on up to threads threads.
+		// The first min_elements are read on the calling thread, the rest is split by skipping over it,
+		// which is only supported for readers of a plain buffer (e.g. Json_reader(std::string_view) without String_arena)
+		void parallel_lists(unsigned threads, std::size_t min_elements=1024) {
+			parallel_threads = std::max(threads, 1u);
+			parallel_min_elements = min_elements;
+		}
+
 		private:
 			std::string buffer;
 			Error_handler error_handler;
+			bool ignore_unknown = false;
+			unsigned parallel_threads = 1;
+			std::size_t parallel_min_elements = 1024;
 
 			void on_error(const std::string& e) {
 				if(error_handler)
 					error_handler(e, reader.row(), reader.column());
+				else if constexpr(details::has_on_error<Reader>::value)
+					reader.on_error(e);
 				else
 					std::cerr<<"Error parsing JSON at "<<reader.row()<<":"<<reader.column()<<" : "<<e<<std::endl;
 			}
 
-			template<class K, class T>
-			int read_member_pair(bool& match, String_literal n, std::pair<K, T&> inst) {
-				if(!match && inst.first==n) {
-					read_value(inst.second);
-					match = true;
+			void on_too_many_elements(std::size_t capacity) {
+				on_error("Too many elements for a container of size "+std::to_string(capacity));
+			}
+
+			void on_unknown_key(std::string_view key) {
+				if(!ignore_unknown)
+					on_error("Unexpected key "+std::string(key));
+
+				reader.skip_value();
+			}
+
+			auto read_key() -> std::string_view {
+				if constexpr(details::has_read_key<Reader>::value) {
+					return reader.read_key(buffer);
+				} else {
+					reader.read(buffer);
+					return buffer;
 				}
-				return 0;
+			}
+
+			// reads the remaining elements of the current array into inst[first_index...]
+			template<class T>
+			bool read_list_parallel(T& inst, std::size_t first_index) {
+				auto elements = std::vector<std::string_view>();
+				if(!reader.read_remaining_array_elements(elements))
+					return false;
+
+				inst.resize(first_index + elements.size());
+
+				auto chunk_size = std::max<std::size_t>(64, elements.size() / (parallel_threads*8));
+				auto chunks = (elements.size() + chunk_size - 1) / chunk_size;
+				auto error_mutex = std::mutex{};
+
+				struct Chunk_error {
+					std::string message;
+					uint32_t row;
+					uint32_t column;
+				};
+				auto chunk_errors = std::vector<std::optional<Chunk_error>>(chunks);
+
+				details::parallel_for(chunks, parallel_threads, 1, [&](std::size_t chunk) {
+					auto first = chunk * chunk_size;
+					auto last = std::min(first+chunk_size, elements.size());
+					auto text = std::string_view(elements[first].data(), static_cast<std::size_t>(
+					        elements[last-1].data() + elements[last-1].size() - elements[first].data()));
+
+					// positions are relative to the chunk and have to be translated
+					auto translate = [&](uint32_t row, uint32_t column) {
+						auto [base_row, base_column] = reader.position_of(text.data());
+						return std::make_pair(base_row+row-1, row==1 ? base_column+column-1 : column);
+					};
+
+					auto handler = Error_handler{};
+					if(error_handler) {
+						handler = [&](auto& msg, uint32_t row, uint32_t column) {
+							auto [error_row, error_column] = translate(row, column);
+							auto lock = std::lock_guard<std::mutex>{error_mutex};
+							error_handler(msg, error_row, error_column);
+						};
+					}
+
+					using Slice_reader = typename Reader::Slice_reader;
+					auto record_error = [&](const std::string& msg, uint32_t row, uint32_t column) {
+						auto [error_row, error_column] = translate(row, column);
+						chunk_errors[chunk] = Chunk_error{msg, error_row, error_column};
+					};
+
+					auto worker = [&] {
+						if constexpr(std::is_constructible<Slice_reader, std::string_view, Error_handler>::value)
+							return Deserializer<Slice_reader>{Slice_reader{text, Error_handler{record_error}}, handler};
+						else
+							return Deserializer<Slice_reader>{Slice_reader{text}, handler};
+					}();
+					worker.ignore_unknown = ignore_unknown;
+					worker.reader.continue_array();
+					for(auto i=first; i<last; i++) {
+						if(i>first)
+							worker.reader.in_array(); // ,
+						worker.read_value(inst[first_index+i]);
+					}
+
+					if constexpr(!std::is_constructible<Slice_reader, std::string_view, Error_handler>::value) {
+						auto& error = worker.reader.error_policy();
+						if(error.failed())
+							record_error(error.message(), error.row(), error.column());
+					}
+				});
+
+				// the first error of the array is reported through the error policy of this reader
+				for(auto& error : chunk_errors) {
+					if(error) {
+						reader.on_error(error->message, error->row, error->column);
+						break;
+					}
+				}
+
+				return true;
+			}
+
+			template<std::size_t... I, class... Members>
+			bool read_member_pair(std::size_t index, std::index_sequence<I...>, Members&... m) {
+				return ((I==index && (read_value(m.second), true)) || ...);
+			}
+
+			template<class T, std::size_t I>
+			static void read_member(Deserializer& self, T& inst) {
+				self.read_value(inst.*std::get<I>(get_struct_info<T>().member_ptrs()));
+			}
+
+			// one function per member, indexed like Struct_info::members()
+			template<class T, std::size_t... I>
+			static constexpr auto member_readers(std::index_sequence<I...>) {
+				return std::array<void(*)(Deserializer&, T&), sizeof...(I)>{{&read_member<T, I>...}};
+			}
+
+			template<class T>
+			void read_struct(T& inst) {
+				using Info = std::decay_t<decltype(get_struct_info<T>())>;
+				static constexpr auto readers = member_readers<T>(std::make_index_sequence<Info::member_count>{});
+
+				auto& info = get_struct_info<T>();
+				auto& names = info.members();
+
+				// documents written by the Serializer list the members in declaration order,
+				// so the member after the last match is compared first, before the hash lookup
+				auto expected = std::size_t(0);
+
+				while(reader.in_obj()) {
+					auto key = read_key();
+
+					auto index = expected<Info::member_count
+					             && std::string_view(names[expected].data, names[expected].len)==key
+					                     ? static_cast<int>(expected)
+					                     : info.index_of_key(key);
+					if(index>=0) {
+						readers[static_cast<std::size_t>(index)](*this, inst);
+						expected = static_cast<std::size_t>(index) + 1;
+					} else {
+						on_unknown_key(key);
+					}
+				}
+
+				details::call_post_load(inst);
 			}
 
 		public:
@@ -471,33 +809,30 @@ namespace sf2 {
 			template<class T>
 			std::enable_if_t<is_annotated_struct<T>::value && !details::has_load<Reader,T>::value>
 			  read_value(T& inst) {
-				while(reader.in_obj()) {
-					reader.read(buffer);
-
-					bool match = false;
-					auto key = String_literal{buffer};
-
-					get_struct_info<T>().for_each([&](auto n, auto mptr) {
-						if(!match && n==key) {
-							this->read_value(inst.*mptr);
-							match = true;
-						}
-					});
-
-					if(!match) {
-						on_error("Unexpected key "+buffer);
-					}
-				}
-
-				details::call_post_load(inst);
+				read_struct(inst);
 			}
 
 			// annotated enum
 			template<class T>
 			std::enable_if_t<is_annotated_enum<T>::value && !details::has_load<Reader,T>::value>
 			  read_value(T& inst) {
-				reader.read(buffer);
-				inst = get_enum_info<T>().value_of(buffer);
+				auto& info = get_enum_info<T>();
+
+				if(reader.peek()=='"') {
+					reader.read(buffer);
+					if(!info.try_value_of(String_literal{buffer}, inst))
+						on_error("Unknown enum value "+buffer);
+
+				} else {
+					// read as a 64 bit integer, because readers don't support all underlying types (e.g. char)
+					using Underlying = std::underlying_type_t<T>;
+					auto value = details::Widened_integer<Underlying>{};
+					read_value(value);
+					inst = static_cast<T>(value);
+					if(!reader.failed() && (static_cast<decltype(value)>(static_cast<Underlying>(value))!=value
+					                        || !info.valid(inst)))
+						on_error("Unknown enum value "+std::to_string(value));
+				}
 
 				details::call_post_load(inst);
 			}
@@ -510,14 +845,28 @@ namespace sf2 {
 			  read_value(T& inst) {
 				inst.clear();
 
+				if constexpr(details::has_reserve<T>::value && details::has_size_hints<Reader>::value) {
+					inst.reserve(reader.object_size_hint());
+				}
+
 				while(reader.in_obj()) {
 					typename T::key_type key;
-					typename T::mapped_type val;
-
 					read_value(key);
-					read_value(val);
 
-					inst.emplace(std::move(key), std::move(val));
+					// values are constructed in the container and read in place
+					if constexpr(details::has_try_emplace<T>::value && details::has_key_compare<T>::value) {
+						// written maps are sorted, so the new entry belongs at the end
+						read_value(inst.try_emplace(inst.end(), std::move(key))->second);
+
+					} else if constexpr(details::has_try_emplace<T>::value) {
+						read_value(inst.try_emplace(std::move(key)).first->second);
+
+					} else {
+						typename T::mapped_type val;
+						read_value(val);
+
+						inst.emplace(std::move(key), std::move(val));
+					}
 				}
 			}
 
@@ -529,11 +878,37 @@ namespace sf2 {
 			  read_value(T& inst) {
 				inst.clear();
 
+				if constexpr(details::has_reserve<T>::value && details::has_size_hints<Reader>::value) {
+					inst.reserve(reader.array_size_hint());
+				}
+
 				while(reader.in_array()) {
 					typename T::value_type v;
 					read_value(v);
 
-					inst.emplace(std::move(v));
+					if constexpr(details::has_key_compare<T>::value)
+						inst.emplace_hint(inst.end(), std::move(v));
+					else
+						inst.emplace(std::move(v));
+				}
+			}
+
+			// std::array and C arrays, elements that are missing from the input keep their values
+			template<class T>
+			std::enable_if_t<!details::has_load<Reader,T>::value
+			                 && details::is_fixed_array<T>::value>
+			  read_value(T& inst) {
+				auto size = std::size_t(0);
+
+				while(reader.in_array()) {
+					if(size<std::size(inst)) {
+						read_value(inst[size]);
+					} else {
+						if(size==std::size(inst))
+							on_too_many_elements(std::size(inst));
+						reader.skip_value();
+					}
+					size++;
 				}
 			}
 
@@ -541,15 +916,66 @@ namespace sf2 {
 			template<class T>
 			std::enable_if_t<!is_annotated<T>::value
 			                 && !details::has_load<Reader,T>::value
-			                 && details::is_list<T>::value>
+			                 && details::is_list<T>::value
+			                 && !details::is_fixed_array<T>::value>
 			  read_value(T& inst) {
-				inst.clear();
+				// numbers are parsed faster in one loop than on multiple threads after splitting them
+				if constexpr(details::can_read_numbers<Reader, T>::value) {
+					if(reader.read_numbers(inst))
+						return;
+				}
 
-				while(reader.in_array()) {
-					typename T::value_type v;
-					read_value(v);
+				if constexpr(details::has_reserve<T>::value && details::has_size_hints<Reader>::value) {
+					auto size = reader.array_size_hint();
+					if(size>inst.size())
+						inst.reserve(size);
+				}
+
+				// proxy references (e.g. of std::vector<bool>) can't be read into directly
+				if constexpr(!std::is_same<decltype(*inst.begin()), typename T::value_type&>::value) {
+					inst.clear();
+
+					while(reader.in_array()) {
+						typename T::value_type v{};
+						read_value(v);
+
+						inst.emplace_back(std::move(v));
+					}
+
+				} else {
+					// existing elements are overwritten in place, so they keep their allocations
+					// (but also the values of struct members that are missing from the input)
+					auto old_size = inst.size();
+					auto size = std::size_t(0);
+					auto next = inst.begin();
+
+					auto capacity = std::numeric_limits<std::size_t>::max();
+					if constexpr(details::is_static_vector<T>::value)
+						capacity = inst.capacity();
+
+					while(reader.in_array()) {
+						// only lists that are long enough are split, the elements before are read as usual
+						if constexpr(details::is_parallel_vector<T>::value && details::can_split_arrays<Reader>::value) {
+							if(size==parallel_min_elements && parallel_threads>1 && read_list_parallel(inst, size))
+								return;
+						}
 
-					inst.emplace_back(std::move(v));
+						if(size<old_size) {
+							read_value(*next);
+							++next;
+						} else if(size>=capacity) {
+							if(size==capacity)
+								on_too_many_elements(capacity);
+							reader.skip_value();
+						} else {
+							inst.emplace_back();
+							read_value(inst.back());
+						}
+						size++;
+					}
+
+					if(size<old_size)
+						inst.erase(next, inst.end());
 				}
 			}
 
@@ -574,10 +1000,16 @@ namespace sf2 {
 			void read_value(std::string& inst) {
 				reader.read(inst);
 			}
+			void read_value(std::string_view& inst) {
+				reader.read(inst);
+			}
 
 			void skip_obj() {
 				reader.skip_obj();
 			}
+			void skip_value() {
+				reader.skip_value();
+			}
 	};
 
 	template<typename Reader, typename T>
@@ -18,8 +18,14 @@
 #define SF2_HPP_
 #pragma once
 
+#include "array_stream.hpp"
+#include "document.hpp"
+#include "mapped_file.hpp"
+#include "ndjson.hpp"
+#include "push_parser.hpp"
 #include "reflection.hpp"
 #include "serializer.hpp"
+#include "static_vector.hpp"
 
 #include "formats/json_reader.hpp"
 #include "formats/json_writer.hpp"
@@ -78,6 +84,92 @@ namespace sf2 {
 		        std::forward<Members>(m)...);
 	}
 
+	// overloads for documents that are already in memory
+	template <typename T>
+	inline auto deserialize_json(std::string_view buffer) -> T
+	{
+		auto v = T();
+		JsonDeserializer{format::Json_reader{buffer}}.read(v);
+		return v;
+	}
+	template <typename T>
+	inline void deserialize_json(std::string_view buffer, T& v)
+	{
+		JsonDeserializer{format::Json_reader{buffer}}.read(v);
+	}
+	template <typename T>
+	inline void deserialize_json(std::string_view buffer, format::Error_handler on_error, T& v)
+	{
+		JsonDeserializer{format::Json_reader{buffer, on_error}, on_error}.read(v);
+	}
+	// std::string_view members reference the buffer or (if that isn't possible) the arena
+	// and are only valid as long as both of them are
+	template <typename T>
+	inline void deserialize_json(std::string_view buffer, String_arena& arena, T& v)
+	{
+		auto reader = format::Json_reader{buffer};
+		reader.string_arena(&arena);
+		JsonDeserializer{std::move(reader)}.read(v);
+	}
+	// destructive parsing: escaped strings are decoded inside the buffer, so std::string_view members
+	// never need an arena, but the buffer content is garbage afterwards
+	template <typename T>
+	inline void deserialize_json_in_situ(std::string& buffer, T& v)
+	{
+		JsonDeserializer{format::Json_reader{format::in_situ, buffer.data(), buffer.size()}}.read(v);
+	}
+	template <typename T>
+	inline void deserialize_json_in_situ(std::string& buffer, format::Error_handler on_error, T& v)
+	{
+		JsonDeserializer{format::Json_reader{format::in_situ, buffer.data(), buffer.size(), on_error}, on_error}
+		        .read(v);
+	}
+
+	template <typename... Members>
+	inline void deserialize_json_virtual(std::string_view buffer, Members&&... m)
+	{
+		JsonDeserializer{format::Json_reader{buffer}}.read_virtual(std::forward<Members>(m)...);
+	}
+	template <typename... Members>
+	inline void deserialize_json_virtual(std::string_view buffer, format::Error_handler on_error, Members&&... m)
+	{
+		JsonDeserializer{format::Json_reader{buffer, on_error}, on_error}.read_virtual(
+		        std::forward<Members>(m)...);
+	}
+
+	// reports errors by returning them instead of calling an Error_handler
+	template <typename T>
+	inline auto try_deserialize_json(std::string_view buffer, T& v) -> format::Store_error
+	{
+		auto deserializer = Deserializer<format::Basic_json_reader<format::Store_error>>{
+		        format::Basic_json_reader<format::Store_error>{buffer}};
+		deserializer.read(v);
+		return deserializer.reader.error_policy();
+	}
+
+	// maps the file into memory and parses it in place
+	// returns false if the file couldn't be opened
+	template <typename T>
+	inline bool deserialize_json_file(const std::string& path, T& v)
+	{
+		auto file = Mapped_file{path};
+		if(!file.valid())
+			return false;
+
+		deserialize_json(file.view(), v);
+		return true;
+	}
+	template <typename T>
+	inline bool deserialize_json_file(const std::string& path, format::Error_handler on_error, T& v)
+	{
+		auto file = Mapped_file{path};
+		if(!file.valid())
+			return false;
+
+		deserialize_json(file.view(), on_error, v);
+		return true;
+	}
+
 } // namespace sf2
 
 #endif
@@ -0,0 +1,138 @@
+/***********************************************************\
+ * Vector with a fixed capacity and inline storage         *
+ *     ___________ _____                                   *
+ *    /  ___|  ___/ __  \                                  *
+ *    \ `--.| |_  `' / /'                                  *
+ *     `--. \  _|   / /                                    *
+ *    /\__/ / |   ./ /___                                  *
+ *    \____/\_|   \_____/                                  *
+ *                                                         *
+ *                                                         *
+ *  Copyright (c) 2014 Florian Oetke                       *
+ *                                                         *
+ *  This file is part of SF2 and distributed under         *
+ *  the MIT License. See LICENSE file for details.         *
+\***********************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <initializer_list>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace sf2 {
+
+	/*
+	 * Vector whose elements are stored inside the object, so it never allocates, but can't grow
+	 * beyond its capacity N. Arrays that don't fit are reported as errors by the Deserializer.
+	 */
+	template<class T, std::size_t N>
+	class static_vector {
+		public:
+			using value_type      = T;
+			using size_type       = std::size_t;
+			using difference_type = std::ptrdiff_t;
+			using reference       = T&;
+			using const_reference = const T&;
+			using iterator        = T*;
+			using const_iterator  = const T*;
+
+			static_vector() noexcept = default;
+			static_vector(std::initializer_list<T> values) {
+				for(auto& v : values)
+					push_back(v);
+			}
+			static_vector(const static_vector& rhs) {
+				for(auto& v : rhs)
+					push_back(v);
+			}
+			static_vector(static_vector&& rhs) noexcept(std::is_nothrow_move_constructible<T>::value) {
+				for(auto& v : rhs)
+					push_back(std::move(v));
+			}
+			~static_vector() {
+				clear();
+			}
+
+			auto operator=(const static_vector& rhs) -> static_vector& {
+				if(this!=&rhs) {
+					clear();
+					for(auto& v : rhs)
+						push_back(v);
+				}
+				return *this;
+			}
+			auto operator=(static_vector&& rhs) noexcept(std::is_nothrow_move_constructible<T>::value)
+			    -> static_vector& {
+				if(this!=&rhs) {
+					clear();
+					for(auto& v : rhs)
+						push_back(std::move(v));
+				}
+				return *this;
+			}
+
+			auto data()noexcept -> T* {return std::launder(reinterpret_cast<T*>(_storage));}
+			auto data()const noexcept -> const T* {return std::launder(reinterpret_cast<const T*>(_storage));}
+
+			auto begin()noexcept -> iterator {return data();}
+			auto end()noexcept -> iterator {return data() + _size;}
+			auto begin()const noexcept -> const_iterator {return data();}
+			auto end()const noexcept -> const_iterator {return data() + _size;}
+
+			auto size()const noexcept {return _size;}
+			auto empty()const noexcept {return _size==0;}
+			static constexpr auto capacity()noexcept {return N;}
+			static constexpr auto max_size()noexcept {return N;}
+
+			auto operator[](std::size_t i) -> T& {return data()[i];}
+			auto operator[](std::size_t i)const -> const T& {return data()[i];}
+			auto front() -> T& {return data()[0];}
+			auto front()const -> const T& {return data()[0];}
+			auto back() -> T& {return data()[_size-1];}
+			auto back()const -> const T& {return data()[_size-1];}
+
+			template<class... Args>
+			auto emplace_back(Args&&... args) -> T& {
+				assert(_size<N && "static_vector is full");
+				auto element = ::new(static_cast<void*>(data() + _size)) T(std::forward<Args>(args)...);
+				_size++;
+				return *element;
+			}
+			void push_back(const T& v) {emplace_back(v);}
+			void push_back(T&& v) {emplace_back(std::move(v));}
+			void pop_back() {
+				data()[--_size].~T();
+			}
+
+			auto erase(const_iterator first, const_iterator last) -> iterator {
+				auto erase_begin = begin() + (first - begin());
+				auto new_end = std::move(begin() + (last - begin()), end(), erase_begin);
+				for(auto e=new_end; e!=end(); ++e)
+					e->~T();
+
+				_size = static_cast<std::size_t>(new_end - begin());
+				return erase_begin;
+			}
+			void clear() noexcept {
+				while(_size>0)
+					pop_back();
+			}
+
+			friend bool operator==(const static_vector& lhs, const static_vector& rhs) {
+				return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());
+			}
+			friend bool operator!=(const static_vector& lhs, const static_vector& rhs) {
+				return !(lhs==rhs);
+			}
+
+		private:
+			alignas(T) unsigned char _storage[N>0 ? N*sizeof(T) : 1];
+			std::size_t _size = 0;
+	};
+
+}
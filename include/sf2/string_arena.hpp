@@ -0,0 +1,67 @@
+/***********************************************************\
+ * Storage for strings referenced by std::string_view      *
+ *     ___________ _____                                   *
+ *    /  ___|  ___/ __  \                                  *
+ *    \ `--.| |_  `' / /'                                  *
+ *     `--. \  _|   / /                                    *
+ *    /\__/ / |   ./ /___                                  *
+ *    \____/\_|   \_____/                                  *
+ *                                                         *
+ *                                                         *
+ *  Copyright (c) 2014 Florian Oetke                       *
+ *                                                         *
+ *  This file is part of SF2 and distributed under         *
+ *  the MIT License. See LICENSE file for details.         *
+\***********************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace sf2 {
+
+	/*
+	 * Bump allocator for strings that can't point into the input buffer (e.g. because they
+	 * contained escape sequences). Stored strings stay valid until the arena is cleared or destroyed.
+	 */
+	class String_arena {
+	  public:
+		explicit String_arena(std::size_t block_size = 4096) : _block_size(block_size) {}
+
+		auto store(std::string_view str) -> std::string_view
+		{
+			if(str.size() > _left) {
+				auto size = std::max(_block_size, str.size());
+				_blocks.emplace_back(new char[size]);
+				_current = _blocks.back().get();
+				_left    = size;
+			}
+
+			if(!str.empty())
+				std::memcpy(_current, str.data(), str.size());
+
+			auto stored = std::string_view(_current, str.size());
+			_current += str.size();
+			_left -= str.size();
+			return stored;
+		}
+
+		void clear()
+		{
+			_blocks.clear();
+			_current = nullptr;
+			_left    = 0;
+		}
+
+	  private:
+		std::vector<std::unique_ptr<char[]>> _blocks;
+		std::size_t                          _block_size;
+		char*                                _current = nullptr;
+		std::size_t                          _left    = 0;
+	};
+
+} // namespace sf2
@@ -0,0 +1,829 @@
+
+// all checks are asserts, that have to run (and use their variables) in release builds, too
+#undef NDEBUG
+
+#include <iostream>
+#include <cassert>
+#include <sstream>
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <memory>
+#include <streambuf>
+#include <limits>
+#include <algorithm>
+#include <cmath>
+#include <array>
+#include <mutex>
+#include <stdexcept>
+
+#include <sf2/sf2.hpp>
+
+
+enum class Kind {
+	small, large
+};
+sf2_enumDef(Kind, small, large);
+
+struct Item {
+	std::string name;
+	Kind kind;
+	std::vector<int32_t> values;
+	double weight;
+};
+sf2_structDef(Item, name, kind, values, weight);
+
+struct Inventory {
+	std::string owner;
+	std::vector<Item> items;
+	std::map<std::string, std::string> tags;
+};
+sf2_structDef(Inventory, owner, items, tags);
+
+struct Request {
+	std::string_view method;
+	std::string_view path;
+	std::vector<std::string_view> headers;
+};
+sf2_structDef(Request, method, path, headers);
+
+struct Wide {
+	int alpha, beta, gamma, delta, epsilon, zeta, eta, theta, iota, kappa, lambda, mu;
+	int ab, ba, abc, cba;
+};
+sf2_structDef(Wide, alpha, beta, gamma, delta, epsilon, zeta, eta, theta, iota, kappa, lambda, mu,
+              ab, ba, abc, cba);
+
+enum class Sparse : int16_t {
+	low = -40, mid = 7, high = 900
+};
+sf2_enumDef(Sparse, high, low, mid);
+
+enum class Letter : char {
+	a = 'a', b = 'b'
+};
+sf2_enumDef(Letter, a, b);
+
+// hand-written factory with an Enum_info that is built at runtime
+enum class Legacy {
+	old, older
+};
+inline auto& sf2_enum_info_factory(Legacy*) {
+	static auto data = sf2::Enum_info<Legacy>{"Legacy", {{Legacy::old, "old"}, {Legacy::older, "older"}}};
+	return data;
+}
+
+struct Flags {
+	Kind kind;
+	Sparse sparse;
+	std::map<Sparse, Kind> by_sparse;
+};
+sf2_structDef(Flags, kind, sparse, by_sparse);
+
+static_assert(sf2::make_enum_info<Sparse>("Sparse", std::make_pair(Sparse::mid, sf2::String_literal{"mid"}),
+                                          std::make_pair(Sparse::low, sf2::String_literal{"low"}))
+                      .value_of(sf2::String_literal{"low"})==Sparse::low,
+              "enum info is usable at compile time");
+
+struct Shape {
+	std::array<float, 3> position;
+	int indices[4];
+	sf2::static_vector<std::string, 3> labels;
+};
+sf2_structDef(Shape, position, indices, labels);
+
+constexpr auto key_table = sf2::details::Key_table<4>{{{"x", "xy", "yx", "xyz"}}};
+static_assert(key_table.find("xy")==1 && key_table.find("xyz")==3 && key_table.find("z")==-1
+              && key_table.find_key("yx")==2 && key_table.find_key("zz")==-1 && key_table.find_key("zzzz")==-1,
+              "key table is usable at compile time");
+
+
+// error policy that never builds the message
+struct Count_errors {
+	int* count;
+	template<class Message>
+	void operator()(const Message&, uint32_t, uint32_t) { (*count)++; }
+};
+
+// reference implementation of the structural index
+std::vector<uint32_t> scalar_index(const std::string& doc) {
+	auto positions = std::vector<uint32_t>();
+	auto in_string = false;
+	auto prev_scalar = false;
+	for(std::size_t i=0; i<doc.size(); i++) {
+		auto c = doc[i];
+		if(in_string) {
+			if(c=='\\') {
+				i++;
+			} else if(c=='"') {
+				positions.push_back(static_cast<uint32_t>(i));
+				in_string = false;
+			}
+			prev_scalar = false;
+			continue;
+		}
+
+		switch(c) {
+			case '"':
+				positions.push_back(static_cast<uint32_t>(i));
+				in_string = true;
+				prev_scalar = false;
+				break;
+			case '{': case '}': case '[': case ']': case ':': case ',':
+			case ' ': case '\t': case '\n': case '\r':
+				if(c!=' ' && c!='\t' && c!='\n' && c!='\r')
+					positions.push_back(static_cast<uint32_t>(i));
+				prev_scalar = false;
+				break;
+			default:
+				if(!prev_scalar)
+					positions.push_back(static_cast<uint32_t>(i));
+				prev_scalar = true;
+				break;
+		}
+	}
+	return positions;
+}
+
+// not seekable and only makes a few characters available at once, like a pipe
+class Trickle_buffer : public std::streambuf {
+	public:
+		explicit Trickle_buffer(std::string data) : _data(std::move(data)) {}
+
+	protected:
+		int_type underflow() override {
+			if(_pos>=_data.size())
+				return traits_type::eof();
+
+			auto n = std::min(_data.size()-_pos, 1 + _pos%7);
+			_data.copy(_buffer, n, _pos);
+			_pos += n;
+			setg(_buffer, _buffer, _buffer+n);
+			return traits_type::to_int_type(_buffer[0]);
+		}
+
+	private:
+		std::string _data;
+		std::size_t _pos = 0;
+		char _buffer[8];
+};
+
+template<class T>
+std::string to_json(const T& value) {
+	std::stringstream out;
+	sf2::serialize_json(out, value);
+	return out.str();
+}
+
+int main() {
+	std::cout<<"Test_reader:"<<std::endl;
+
+	auto inv = Inventory{};
+	inv.owner = "Somebody with a \"quoted\" name";
+	for(int i=0; i<200; i++) {
+		auto name = std::string(static_cast<std::size_t>(i%70), 'x');
+		name += std::string(static_cast<std::size_t>(i%5), '"');
+		inv.items.push_back(Item{name, i%3==0 ? Kind::large : Kind::small,
+		                         {i, -i, i*1000}, i*0.5});
+	}
+	inv.tags["a"] = "b";
+	inv.tags["escaped\""] = "\"";
+
+	auto json = to_json(inv);
+
+	// structural index matches the reference implementation
+	auto index = sf2::format::Structural_index{json};
+	assert(index.valid());
+	assert(index.positions()==scalar_index(json) && "structural index doesn't match reference");
+
+	// all readers produce the same result
+	auto from_stream = Inventory{};
+	auto stream = std::istringstream{json};
+	sf2::deserialize_json(stream, from_stream);
+
+	auto from_buffer = sf2::deserialize_json<Inventory>(std::string_view{json});
+
+	auto from_index = Inventory{};
+	sf2::JsonDeserializer{sf2::format::Json_reader{json, {}, sf2::format::Index_mode::structural}}
+	        .read(from_index);
+
+	auto trickle = Trickle_buffer{json};
+	auto pipe = std::istream{&trickle};
+	auto from_pipe = Inventory{};
+	sf2::deserialize_json(pipe, from_pipe);
+
+	assert(to_json(from_stream)==json);
+	assert(to_json(from_pipe)==json);
+	assert(to_json(from_buffer)==json);
+	assert(to_json(from_index)==json);
+
+	// runs of backslashes across block boundaries
+	for(int i=0; i<140; i++) {
+		auto doc = "[\"" + std::string(static_cast<std::size_t>(i), 'x') + std::string(static_cast<std::size_t>(i%7)*2, '\\')
+		           + "\\\"\", \"" + std::string(static_cast<std::size_t>(i%9)*2, '\\') + "\", 42]";
+		assert(sf2::format::Structural_index{doc}.positions()==scalar_index(doc));
+	}
+
+	// floating point values are correctly rounded
+	auto doubles = std::vector<double>();
+	auto floats = std::vector<float>();
+	sf2::deserialize_json_virtual(std::string_view{R"({
+		"d": [0.1, 1e23, -2.2250738585072014e-308, 9007199254740993, +5, 1E2, 1e999],
+		"f": [0.1, 3.4028235e38, 1.17549435e-38, -7.038531e-26]
+	})"}, sf2::vmember("d", doubles), sf2::vmember("f", floats));
+	assert((doubles==std::vector<double>{0.1, 1e23, -2.2250738585072014e-308, 9007199254740993.0,
+	                                     5.0, 100.0, std::numeric_limits<double>::infinity()}));
+	assert((floats==std::vector<float>{0.1f, 3.4028235e38f, 1.17549435e-38f, -7.038531e-26f}));
+
+	// values outside of the range saturate to infinity or zero, denormalized values are kept
+	sf2::deserialize_json_virtual(std::string_view{R"({
+		"d": [-1e999, 0.0001e-330, -12.5e-400, 1e-310, 123456e305, 0.00001e312],
+		"f": [1e39, -1e-50, 0.001e-44, 1e-40]
+	})"}, sf2::vmember("d", doubles), sf2::vmember("f", floats));
+	assert((doubles==std::vector<double>{-std::numeric_limits<double>::infinity(), 0.0, -0.0, 1e-310,
+	                                     std::numeric_limits<double>::infinity(), 1e307}));
+	assert(std::signbit(doubles[2]) && !std::signbit(doubles[1]));
+	assert((floats==std::vector<float>{std::numeric_limits<float>::infinity(), -0.0f, 0.0f, 1e-40f}));
+
+	// long integers and range checks
+	auto ids = std::vector<uint64_t>();
+	auto timestamps = std::vector<int64_t>();
+	sf2::deserialize_json_virtual(std::string_view{R"({
+		"ids": [18446744073709551615, 1234567890123456789, 0, 42],
+		"ts": [-9223372036854775808, 9223372036854775807, -1600000000123]
+	})"}, sf2::vmember("ids", ids), sf2::vmember("ts", timestamps));
+	assert((ids==std::vector<uint64_t>{18446744073709551615u, 1234567890123456789u, 0, 42}));
+	assert((timestamps==std::vector<int64_t>{std::numeric_limits<int64_t>::min(),
+	                                         9223372036854775807, -1600000000123}));
+
+	auto overflow_error = std::string();
+	auto small = int8_t(0);
+	sf2::deserialize_json_virtual(std::string_view{R"({"v": -129})"},
+	                              sf2::format::Error_handler{[&](auto& msg, auto, auto) { overflow_error = msg; }},
+	                              sf2::vmember("v", small));
+	assert(overflow_error.find("Overflow")==0);
+
+	// string_views reference the input or the arena for escaped strings
+	auto request_json = std::string(R"({"method": "GET", "path": "/a/\"b\"", "headers": ["x", "y"]})");
+	auto arena = sf2::String_arena{};
+	auto request = Request{};
+	sf2::deserialize_json(request_json, arena, request);
+	assert(request.method=="GET" && request.path=="/a/\"b\"");
+	assert((request.headers==std::vector<std::string_view>{"x", "y"}));
+	assert(request.method.data() > request_json.data()
+	       && request.method.data() < request_json.data()+request_json.size());
+	assert(request.path.data() < request_json.data()
+	       || request.path.data() >= request_json.data()+request_json.size());
+
+	auto request_out = std::stringstream{};
+	sf2::serialize_json(request_out, request);
+	auto request_copy = Request{};
+	auto request_str = request_out.str();
+	sf2::deserialize_json(request_str, arena, request_copy);
+	assert(request_copy.path==request.path);
+
+	// in situ parsing decodes escaped strings inside the buffer
+	auto request_in_situ = Request{};
+	auto mutable_json = request_json;
+	sf2::deserialize_json_in_situ(mutable_json, request_in_situ);
+	assert(request_in_situ.path=="/a/\"b\"" && request_in_situ.method=="GET");
+	assert(request_in_situ.path.data() > mutable_json.data()
+	       && request_in_situ.path.data() < mutable_json.data()+mutable_json.size());
+
+	// ... and errors are reported at their position in the original text, not the decoded one
+	auto broken_in_situ = std::string("{\"method\": \"x\\ny\\nz\",\n \"path\": q}");
+	auto in_situ_error_at = std::make_pair(0u, 0u);
+	sf2::deserialize_json_in_situ(broken_in_situ, [&](auto&, uint32_t row, uint32_t column) {
+		in_situ_error_at = {row, column};
+	}, request_in_situ);
+	assert(request_in_situ.method=="x\ny\nz" && in_situ_error_at==std::make_pair(2u, 11u));
+
+	// consecutive documents in one stream
+	auto documents = std::istringstream{R"({"a": null, "b": 1} {"a": 2, "b": 3}  {"a": 4})"};
+	auto first = std::pair<std::unique_ptr<int>, int>();
+	auto second = std::pair<std::unique_ptr<int>, int>();
+	sf2::deserialize_json_virtual(documents, sf2::vmember("a", first.first), sf2::vmember("b", first.second));
+	sf2::deserialize_json_virtual(documents, sf2::vmember("a", second.first), sf2::vmember("b", second.second));
+	assert(!first.first && first.second==1);
+	assert(second.first && *second.first==2 && second.second==3);
+	auto rest = std::string();
+	std::getline(documents, rest);
+	assert(rest=="  {\"a\": 4}");
+
+	// comments are handled by the fallback path
+	auto commented = std::string(R"({ /* comment "with quote */ "a": 1.5, "b": true })");
+	assert(!sf2::format::Structural_index{commented}.valid());
+	auto a = 0.f;
+	auto b = false;
+	sf2::JsonDeserializer{sf2::format::Json_reader{commented, {}, sf2::format::Index_mode::structural}}
+	        .read_virtual(sf2::vmember("a", a), sf2::vmember("b", b));
+	assert(a==1.5f && b);
+
+	// values of unknown keys of any type are skipped
+	auto unknown = std::string(R"({"x": {"a": [1, {"b": "}]"}], "c": "\"{["}, "a": 7, "y": [[], {}, "]", -1.5e3],
+		"z": "str\"ing", "w": null, "v": true, "u": -12, "b": 42})");
+	assert(sf2::format::Structural_index{unknown}.valid());
+	for(auto mode : {sf2::format::Index_mode::none, sf2::format::Index_mode::structural}) {
+		auto x = 0;
+		auto y = 0;
+		auto errors = 0;
+		auto d = sf2::JsonDeserializer{sf2::format::Json_reader{unknown, {}, mode},
+		                               [&](auto&, auto, auto) { errors++; }};
+		d.ignore_unknown_keys(true);
+		d.read_virtual(sf2::vmember("a", x), sf2::vmember("b", y));
+		assert(x==7 && y==42 && errors==0);
+	}
+	{
+		auto unknown_stream = std::istringstream{R"({"t": /* } */ {"s": [/**/]},)" + unknown.substr(1)};
+		auto x = 0;
+		auto y = 0;
+		auto errors = std::vector<std::string>();
+		sf2::deserialize_json_virtual(unknown_stream,
+		                              sf2::format::Error_handler{[&](auto& msg, auto, auto) { errors.push_back(msg); }},
+		                              sf2::vmember("a", x), sf2::vmember("b", y));
+		assert(x==7 && y==42 && errors.size()==7 && errors[0]=="Unexpected key t");
+	}
+
+	// documents are navigated lazily and subtrees deserialized on demand
+	for(auto& doc_json : {json, "/**/" + json}) {
+		auto doc = sf2::Document{doc_json};
+		assert(doc.valid() && doc.root().type()==sf2::Node_type::object);
+		assert(doc["items"].size()==200 && doc.root().size()==3 && doc["tags"].size()==2);
+		assert(doc["items"][3]["name"].as<std::string>()==inv.items[3].name);
+		assert(doc["items"][199]["values"][2].as<int>()==199000);
+		assert(doc["items"][5]["kind"].as<Kind>()==Kind::small);
+		assert(doc["tags"]["escaped\""].as<std::string>()=="\"");
+		assert(!doc["items"][200] && !doc["missing"] && !doc["owner"]["x"] && !doc["items"]["x"]);
+		assert(doc["items"][7]["weight"].type()==sf2::Node_type::number);
+
+		auto item = Item{};
+		auto item_read = doc["items"][42].get(item);
+		assert(item_read);
+		assert(item.name==inv.items[42].name && item.values==inv.items[42].values);
+	}
+	{
+		auto doc = sf2::Document{std::string_view{"{\n  \"a\": [1, 2],\n  \"b\": {\"c\": fals3}\n}"}};
+		auto pos = std::make_pair(0u, 0u);
+		auto c = false;
+		auto c_read = doc["b"]["c"].get(c, [&](auto&, uint32_t row, uint32_t column) { pos = {row, column}; });
+		assert(!c_read && pos==std::make_pair(3u, 19u));
+		assert(doc["a"][1].as<int>()==2 && doc["a"].raw()=="[1, 2]");
+
+		auto errors = 0;
+		auto handler = [&](auto&, auto, auto) { errors++; };
+		assert(!sf2::Document(std::string_view{"[1, {\"a\": 2]"}, handler).valid() && errors==1);
+		assert(!sf2::Document(std::string_view{"{\"a\": \"b"}, handler).valid() && errors==2);
+		assert(!sf2::Document(std::string_view{"  "}, handler).valid() && errors==3);
+		assert(sf2::Document(std::string_view{" 42 "}).root().as<int>()==42);
+
+		// objects have to consist of key-value pairs, with and without structural index (comments)
+		for(auto malformed : {"{\"a\"}", "{\"a\" 1}", "{\"a\": }", "{\"a\": 1,}", "{1: 2}", "[1 2]", "[1,]", "{\"a\":: 1}",
+		                      "/**/{\"a\"}", "/**/{\"a\" 1}", "/**/[1 2]", "/**/{\"a\": 1,}"}) {
+			auto count = errors;
+			auto malformed_doc = sf2::Document(std::string_view{malformed}, handler);
+			assert(!malformed_doc.valid() && errors==count+1 && !malformed_doc["b"]);
+		}
+		assert(sf2::Document(std::string_view{"/**/{\"a\": [1, {}], \"b\": {}}"})["b"].type()==sf2::Node_type::object);
+	}
+
+	// documents that arrive in chunks of any size
+	auto chunked = json + " /* { */" + json + "\n42 \"str\\\"ing\"[1]-7";
+	for(auto chunk_size : {std::size_t(1), std::size_t(3), std::size_t(64), std::size_t(1000), chunked.size()}) {
+		auto parser = sf2::Push_parser{};
+		auto received = std::vector<std::string>();
+		auto number = 0;
+		auto str = std::string();
+		auto list = std::vector<int>();
+
+		for(auto i=std::size_t(0); i<chunked.size(); i+=chunk_size) {
+			parser.feed(std::string_view(chunked).substr(i, chunk_size));
+
+			while(parser.ready()) {
+				if(received.size()<2) {
+					auto v = Inventory{};
+					auto ok = parser.read(v);
+					assert(ok);
+					received.push_back(to_json(v));
+				} else if(received.size()==2) {
+					auto ok = parser.read(number);
+					assert(ok);
+					received.emplace_back();
+				} else if(received.size()==3) {
+					auto ok = parser.read(str);
+					assert(ok);
+					received.emplace_back();
+				} else {
+					auto ok = parser.read(list);
+					assert(ok);
+					received.emplace_back();
+				}
+			}
+		}
+		assert(received.size()==5 && received[0]==json && received[1]==json);
+		assert(number==42 && str=="str\"ing" && list==std::vector<int>{1});
+
+		parser.finish();
+		assert(parser.ready());
+		auto last_ok = parser.read(number);
+		assert(last_ok && number==-7 && parser.buffered()==0);
+	}
+	{
+		auto parser = sf2::Push_parser{};
+		parser.feed("{\"a\": [1, 2");
+		assert(!parser.ready());
+		parser.finish();
+		auto errors = 0;
+		auto a = std::vector<int>();
+		assert(parser.ready());
+		auto ok = parser.read(a, [&](auto&, auto, auto) { errors++; });
+		assert(!ok && errors==1);
+	}
+
+	// large arrays are written and read one element at a time
+	{
+		auto records = std::stringstream{};
+		auto out = sf2::JsonSerializer{sf2::format::Json_writer{records}};
+		out.begin_array();
+		for(auto& item : inv.items)
+			out.write_element(item);
+		out.end_array();
+
+		auto count = std::size_t(0);
+		for(auto& item : sf2::json_array_stream<Item>(records)) {
+			assert(item.name==inv.items[count].name && item.values==inv.items[count].values);
+			count++;
+		}
+		assert(count==inv.items.size());
+
+		auto empty = std::istringstream{" [ ] "};
+		auto empty_stream = sf2::json_array_stream<Item>(empty);
+		assert(empty_stream.begin()==empty_stream.end());
+	}
+
+	// newline delimited records are written on single lines and read in parallel
+	{
+		auto lines = std::stringstream{};
+		for(auto& item : inv.items)
+			sf2::serialize_ndjson(lines, item);
+		lines<<"\n   \n";
+		auto ndjson = lines.str();
+		assert(static_cast<std::size_t>(std::count(ndjson.begin(), ndjson.end(), '\n'))==inv.items.size()+2);
+
+		for(auto threads : {1u, 4u}) {
+			auto items = sf2::deserialize_ndjson<Item>(ndjson, threads);
+			assert(items.size()==inv.items.size());
+			for(auto i=std::size_t(0); i<items.size(); i++)
+				assert(items[i].name==inv.items[i].name && items[i].values==inv.items[i].values);
+
+			auto seen = std::vector<int>(inv.items.size());
+			auto seen_mutex = std::mutex{};
+			sf2::deserialize_ndjson_unordered<Item>(ndjson, [&](std::size_t i, Item&& item) {
+				auto lock = std::lock_guard<std::mutex>{seen_mutex};
+				assert(item.name==inv.items[i].name);
+				seen[i]++;
+			}, threads);
+			assert(std::all_of(seen.begin(), seen.end(), [](int n) { return n==1; }));
+
+			auto thrown = false;
+			try {
+				sf2::deserialize_ndjson_unordered<Item>(ndjson, [&](std::size_t i, Item&&) {
+					if(i%50==7)
+						throw std::runtime_error("callback failed");
+				}, threads);
+			} catch(const std::runtime_error& e) {
+				thrown = std::string(e.what())=="callback failed";
+			}
+			assert(thrown);
+		}
+
+		auto error_row = 0u;
+		auto broken_lines = std::string("{\"a\": 1}\n\n{\"a\": x}\n");
+		auto values = sf2::deserialize_ndjson<std::map<std::string, int>>(broken_lines, 2,
+		                                                                 [&](auto&, uint32_t row, auto) { error_row = row; });
+		assert(values.size()==2 && values[0].at("a")==1 && error_row==3);
+
+		auto special = Item{"", Kind::small, {1, 2}, 0.5};
+		special.name = std::string("l1\nl2\r\\x\"y\t\x01", 12);
+		auto special_lines = std::stringstream{};
+		sf2::serialize_ndjson(special_lines, special);
+		sf2::serialize_ndjson(special_lines, special);
+		auto special_ndjson = special_lines.str();
+		assert(std::count(special_ndjson.begin(), special_ndjson.end(), '\n')==2);
+		auto special_items = sf2::deserialize_ndjson<Item>(special_ndjson, 2);
+		assert(special_items.size()==2 && special_items[0].name==special.name && special_items[1].name==special.name);
+
+		auto unicode_json = std::string(R"({"name": "\u00e4\u20ac\ud83d\ude00\/\n"})");
+		auto unicode = sf2::deserialize_json<Item>(std::string_view{unicode_json});
+		assert(unicode.name=="\xc3\xa4\xe2\x82\xac\xf0\x9f\x98\x80/\n");
+		auto unicode_in_situ = Item{};
+		sf2::deserialize_json_in_situ(unicode_json, unicode_in_situ);
+		assert(unicode_in_situ.name==unicode.name);
+		assert(to_json(unicode).find("\"\xc3\xa4\xe2\x82\xac\xf0\x9f\x98\x80/\\n\"")!=std::string::npos);
+	}
+
+	// large vectors are deserialized in parallel
+	for(auto mode : {sf2::format::Index_mode::none, sf2::format::Index_mode::structural}) {
+		auto from_threads = Inventory{};
+		auto d = sf2::JsonDeserializer{sf2::format::Json_reader{json, {}, mode}};
+		d.parallel_lists(4, 10);
+		d.read(from_threads);
+		assert(to_json(from_threads)==json);
+
+		// lists up to min_elements are read sequentially, longer ones are split after the first min_elements
+		for(auto min_elements : {std::size_t(0), std::size_t(199), std::size_t(200), std::size_t(1000)}) {
+			from_threads.items.resize(inv.items.size()+5);
+			auto min_d = sf2::JsonDeserializer{sf2::format::Json_reader{json, {}, mode}};
+			min_d.parallel_lists(4, min_elements);
+			min_d.read(from_threads);
+			assert(to_json(from_threads)==json);
+		}
+
+		auto broken_items = json;
+		auto broken_at = broken_items.rfind("\"weight\": ") + 10;
+		broken_items.insert(broken_at, "x");
+
+		auto parse_broken = [&](unsigned threads) {
+			auto pos = std::make_pair(0u, 0u);
+			auto handler = [&](auto&, uint32_t row, uint32_t column) { pos = {row, column}; };
+			auto broken_d = sf2::JsonDeserializer{sf2::format::Json_reader{broken_items, handler, mode}, handler};
+			broken_d.parallel_lists(threads, 10);
+			broken_d.read(from_threads);
+			return pos;
+		};
+		assert(parse_broken(1)!=std::make_pair(0u, 0u) && parse_broken(1)==parse_broken(4));
+
+		// errors of the elements use the policy of the reader, which fails like on the sequential path
+		auto parse_broken_reader_only = [&](unsigned threads) {
+			auto pos = std::make_pair(0u, 0u);
+			auto handler = [&](auto&, uint32_t row, uint32_t column) { pos = {row, column}; };
+			auto broken_d = sf2::JsonDeserializer{sf2::format::Json_reader{broken_items, handler, mode}};
+			broken_d.parallel_lists(threads, 10);
+			broken_d.read(from_threads);
+			assert(broken_d.reader.failed());
+			return pos;
+		};
+		assert(parse_broken_reader_only(4)==parse_broken(1));
+
+		using Stored_reader = sf2::format::Basic_json_reader<sf2::format::Store_error>;
+		using Throwing_reader = sf2::format::Basic_json_reader<sf2::format::Throw_on_error>;
+		static_assert(sf2::details::can_split_arrays<Stored_reader>::value
+		              && sf2::details::can_split_arrays<Throwing_reader>::value, "all policies support parallel lists");
+
+		auto stored_d = sf2::Deserializer<Stored_reader>{Stored_reader{broken_items, {}, mode}};
+		stored_d.parallel_lists(4, 10);
+		stored_d.read(from_threads);
+		auto& stored_error = stored_d.reader.error_policy();
+		assert(stored_error.failed() && std::make_pair(stored_error.row(), stored_error.column())==parse_broken(1));
+
+		auto thrown_at = std::make_pair(0u, 0u);
+		try {
+			auto throwing_d = sf2::Deserializer<Throwing_reader>{Throwing_reader{broken_items, {}, mode}};
+			throwing_d.parallel_lists(4, 10);
+			throwing_d.read(from_threads);
+		} catch(const sf2::format::Parse_error& e) {
+			thrown_at = {e.row(), e.column()};
+		}
+		assert(thrown_at==parse_broken(1));
+	}
+
+	// errors are reported at the same position in all modes
+	auto broken = std::string("{\n  \"a\": 1,\n  \"b\": fals3\n}");
+	auto error_at = [&](sf2::format::Index_mode mode) {
+		auto pos = std::make_pair(0u, 0u);
+		auto handler = [&](auto&, uint32_t row, uint32_t column) { pos = {row, column}; };
+		auto x = 0;
+		auto y = false;
+		sf2::JsonDeserializer{sf2::format::Json_reader{broken, handler, mode}}
+		        .read_virtual(sf2::vmember("a", x), sf2::vmember("b", y));
+		return pos;
+	};
+	assert(error_at(sf2::format::Index_mode::none)==std::make_pair(3u, 13u));
+	assert(error_at(sf2::format::Index_mode::structural)==std::make_pair(3u, 13u));
+
+	// positions are computed from offsets, also after the stream buffer has been refilled
+	auto late_error = json;
+	late_error.insert(late_error.rfind("\"weight\": ")+10, "x");
+	auto late_error_at = [&](auto&& make_reader) {
+		auto pos = std::make_pair(0u, 0u);
+		auto handler = [&](auto&, uint32_t row, uint32_t column) { pos = {row, column}; };
+		auto v = Inventory{};
+		sf2::JsonDeserializer{make_reader(handler), handler}.read(v);
+		return pos;
+	};
+	auto late_view = late_error_at([&](auto& h) { return sf2::format::Json_reader{late_error, h}; });
+	auto late_index = late_error_at([&](auto& h) {
+		return sf2::format::Json_reader{late_error, h, sf2::format::Index_mode::structural}; });
+	auto late_stream_source = std::istringstream{late_error};
+	auto late_stream = late_error_at([&](auto& h) { return sf2::format::Json_reader{late_stream_source, h}; });
+	auto late_trickle = Trickle_buffer{late_error};
+	auto late_pipe_source = std::istream{&late_trickle};
+	auto late_pipe = late_error_at([&](auto& h) { return sf2::format::Json_reader{late_pipe_source, h}; });
+	assert(late_view.first>1000 && late_view==late_index && late_view==late_stream && late_view==late_pipe);
+
+	// compile-time error policies
+	try {
+		auto x = 0;
+		auto y = false;
+		sf2::Deserializer<sf2::format::Basic_json_reader<sf2::format::Throw_on_error>>{
+		        sf2::format::Basic_json_reader<sf2::format::Throw_on_error>{broken}}
+		        .read_virtual(sf2::vmember("a", x), sf2::vmember("b", y));
+		assert(!"expected a Parse_error");
+	} catch(const sf2::format::Parse_error& e) {
+		assert(e.row()==3 && e.column()==13 && std::string(e.what())=="Unknown boolean constant 'fals'");
+	}
+
+	// errors found by the Deserializer use the policy of the reader, too
+	try {
+		auto x = 0;
+		sf2::Deserializer<sf2::format::Basic_json_reader<sf2::format::Throw_on_error>>{
+		        sf2::format::Basic_json_reader<sf2::format::Throw_on_error>{std::string_view{"{\"a\": 1, \"c\": 2}"}}}
+		        .read_virtual(sf2::vmember("a", x));
+		assert(!"expected a Parse_error");
+	} catch(const sf2::format::Parse_error& e) {
+		assert(e.row()==1 && std::string(e.what())=="Unexpected key c");
+	}
+
+	auto stored = sf2::try_deserialize_json(std::string_view{"{\"owner\": 5}"}, from_buffer);
+	assert(stored.failed() && stored.row()==1 && stored.column()==12);
+	assert(stored.message()=="Missing '\"' at the start of string");
+	assert(!sf2::try_deserialize_json(std::string_view{json}, from_buffer).failed());
+	assert(sf2::try_deserialize_json(std::string_view{"{\"unknown\": 1}"}, from_buffer).message()
+	       =="Unexpected key unknown");
+
+	auto error_count = 0;
+	auto counted = 0;
+	auto counted_bool = false;
+	sf2::Deserializer<sf2::format::Basic_json_reader<Count_errors>>{
+	        sf2::format::Basic_json_reader<Count_errors>{broken, Count_errors{&error_count}}}
+	        .read_virtual(sf2::vmember("a", counted), sf2::vmember("b", counted_bool));
+	assert(error_count==1);
+
+	// member lookup of large structs and virtual members, independent of the key order
+	auto wide = sf2::deserialize_json<Wide>(std::string_view{R"({"mu": 12, "cba": 16, "alpha": 1, "ba": 14,
+		"kappa": 10, "beta": 2, "abc": 15, "gamma": 3, "delta": 4, "ab": 13, "epsilon": 5, "zeta": 6,
+		"eta": 7, "theta": 8, "iota": 9, "lambda": 11})"});
+	assert(wide.alpha==1 && wide.mu==12 && wide.ab==13 && wide.ba==14 && wide.abc==15 && wide.cba==16);
+	assert(to_json(sf2::deserialize_json<Wide>(std::string_view{to_json(wide)}))==to_json(wide));
+
+	auto gaps = sf2::deserialize_json<Wide>(std::string_view{R"({"alpha": 1, "gamma": 3, "delta": 4, "ab": 5,
+		"beta": 2, "cba": 6})"});
+	assert(gaps.alpha==1 && gaps.beta==2 && gaps.gamma==3 && gaps.delta==4 && gaps.ab==5 && gaps.cba==6);
+
+	// keys with escape sequences are decoded before they are matched
+	auto escaped_keys = std::string(R"({"al\pha": 7, "\u006du": 8})");
+	auto escaped_stream = std::istringstream{escaped_keys};
+	sf2::deserialize_json(escaped_stream, gaps);
+	assert(gaps.alpha==7 && gaps.mu==8);
+
+	auto unknown_key = std::string();
+	auto wide_handler = sf2::format::Error_handler{[&](auto& msg, auto, auto) { unknown_key = msg; }};
+	sf2::deserialize_json(std::string_view{R"({"alpha": 2, "alphb": 3, "mu": 4})"}, wide_handler, wide);
+	assert(unknown_key=="Unexpected key alphb" && wide.alpha==2 && wide.mu==4);
+
+	// enums as names or integers
+	auto& sparse_info = sf2::get_enum_info<Sparse>();
+	assert(sparse_info.name_of(Sparse::mid).str()=="mid" && sparse_info.name_of(Sparse::low).str()=="low");
+	assert(!sparse_info.valid(static_cast<Sparse>(8)));
+	assert(sf2::get_enum_info<Kind>().name_of(Kind::large).str()=="large");
+
+	auto flags = Flags{Kind::large, Sparse::high, {{Sparse::low, Kind::small}, {Sparse::high, Kind::large}}};
+	auto flags_json = to_json(flags);
+	assert(flags_json.find("\"high\"")!=std::string::npos);
+
+	auto flags_int_json = std::stringstream{};
+	auto flags_serializer = sf2::JsonSerializer{sf2::format::Json_writer{flags_int_json}};
+	flags_serializer.enums_as_integers(true);
+	flags_serializer.write(flags);
+	assert(flags_int_json.str().find("900")!=std::string::npos && flags_int_json.str().find("\"low\"")!=std::string::npos);
+	assert(to_json(sf2::deserialize_json<Flags>(std::string_view{flags_int_json.str()}))==flags_json);
+	assert(to_json(sf2::deserialize_json<Flags>(std::string_view{flags_json}))==flags_json);
+
+	auto legacy = std::vector<Legacy>();
+	sf2::deserialize_json_virtual(std::string_view{R"({"l": ["older", 0, "old"]})"}, sf2::vmember("l", legacy));
+	assert((legacy==std::vector<Legacy>{Legacy::older, Legacy::old, Legacy::old}));
+	assert(sf2::get_enum_info<Legacy>().name_of(Legacy::older).str()=="older");
+
+	auto letters = std::vector<Letter>{Letter::b, Letter::a};
+	auto letters_int_json = std::stringstream{};
+	auto letters_serializer = sf2::JsonSerializer{sf2::format::Json_writer{letters_int_json}};
+	letters_serializer.enums_as_integers(true);
+	letters_serializer.write_virtual(sf2::vmember("l", letters));
+	auto letters_copy = std::vector<Letter>();
+	sf2::deserialize_json_virtual(std::string_view{letters_int_json.str()}, sf2::vmember("l", letters_copy));
+	assert(letters_copy==letters && letters_int_json.str().find("98")!=std::string::npos);
+	sf2::deserialize_json_virtual(std::string_view{R"({"l": ["a", "b"]})"}, sf2::vmember("l", letters_copy));
+	assert((letters_copy==std::vector<Letter>{Letter::a, Letter::b}));
+
+	auto enum_error = std::string();
+	auto enum_handler = sf2::format::Error_handler{[&](auto& msg, auto, auto) { enum_error = msg; }};
+	sf2::deserialize_json(std::string_view{R"({"kind": "medium"})"}, enum_handler, flags);
+	assert(enum_error=="Unknown enum value medium");
+	sf2::deserialize_json(std::string_view{R"({"sparse": 8})"}, enum_handler, flags);
+	assert(enum_error=="Unknown enum value 8");
+	sf2::deserialize_json_virtual(std::string_view{R"({"l": [353]})"}, enum_handler, sf2::vmember("l", letters_copy));
+	assert(enum_error=="Unknown enum value 353");
+
+	// lists overwrite their existing elements and are reserved up front with a structural index
+	auto read_list = [](std::string_view json, auto& list) {
+		sf2::JsonDeserializer{sf2::format::Json_reader{json, {}, sf2::format::Index_mode::structural}}.read_value(list);
+	};
+	auto reused = std::vector<std::string>{std::string(100, 'a'), std::string(100, 'b'), "c"};
+	auto reused_data = reused[0].data();
+	read_list(R"(["x", "y"])", reused);
+	assert((reused==std::vector<std::string>{"x", "y"}) && reused[0].data()==reused_data);
+	read_list(R"(["1", "2", "3", "4"])", reused);
+	assert((reused==std::vector<std::string>{"1", "2", "3", "4"}));
+
+	auto bits = std::vector<bool>{true, true, true};
+	read_list("[false, true]", bits);
+	assert((bits==std::vector<bool>{false, true}));
+
+	auto nested_json = std::string(R"([[1, [2, 3], {"a": [4, 5]}, "[6, 7]"], [], [[]], [8,9 , 10]])");
+	auto nested_reader = sf2::format::Json_reader{nested_json, {}, sf2::format::Index_mode::structural};
+	assert(nested_reader.array_size_hint()==4);
+	assert(nested_reader.in_array() && nested_reader.array_size_hint()==4);
+	nested_reader.skip_value();
+	assert(nested_reader.in_array() && nested_reader.array_size_hint()==0);
+	nested_reader.skip_value();
+	assert(nested_reader.in_array() && nested_reader.array_size_hint()==1);
+	nested_reader.skip_value();
+	assert(nested_reader.in_array() && nested_reader.array_size_hint()==3);
+	assert(sf2::format::Json_reader{nested_json}.array_size_hint()==0);
+
+	// arrays of numbers are parsed in bulk from buffers, with the same results and errors as from streams
+	auto numbers_json = std::string("[ 1.5,-2,\n3e2 , /* c */ .25, -0.0, 1e999, 7]");
+	auto bulk_floats = std::vector<float>{9.f};
+	auto bulk_ints = std::vector<int16_t>();
+	read_list(numbers_json, bulk_floats);
+	sf2::JsonDeserializer{sf2::format::Json_reader{numbers_json}}.read_value(floats);
+	assert((bulk_floats==std::vector<float>{1.5f, -2.f, 300.f, .25f, -0.f, std::numeric_limits<float>::infinity(), 7.f}));
+	assert((bulk_floats==floats));
+	read_list("[]", bulk_floats);
+	read_list("[1, 2 ,3]", bulk_ints);
+	assert(bulk_floats.empty() && (bulk_ints==std::vector<int16_t>{1, 2, 3}));
+
+	auto number_error_at = [&](const std::string& numbers, auto list) {
+		auto from_buffer = std::make_pair(std::string(), 0u);
+		auto from_stream = std::make_pair(std::string(), 0u);
+		auto stream = std::istringstream{numbers};
+		sf2::JsonDeserializer{sf2::format::Json_reader{numbers, [&](auto& msg, uint32_t, uint32_t column) {
+			from_buffer = {msg, column}; }}}.read_value(list);
+		sf2::JsonDeserializer{sf2::format::Json_reader{stream, [&](auto& msg, uint32_t, uint32_t column) {
+			from_stream = {msg, column}; }}}.read_value(list);
+		assert(from_buffer==from_stream);
+		return from_buffer;
+	};
+	assert(number_error_at("[1, inf]", std::vector<double>()).second==6);
+	assert(number_error_at("[1, 1.5e]", std::vector<double>()).first=="Invalid number '1.5e'");
+	assert(number_error_at("[1, 2 3]", std::vector<double>()).second==8);
+	assert(number_error_at("[1, 70000]", std::vector<int16_t>()).first.find("Overflow")==0);
+
+	// fixed size arrays and containers with a fixed capacity
+	auto shape = Shape{{1.f, 2.f, 3.f}, {4, 5, 6, 7}, {"a", "b"}};
+	auto shape_json = to_json(shape);
+	auto shape_copy = sf2::deserialize_json<Shape>(std::string_view{shape_json});
+	assert(shape_copy.position==shape.position && std::equal(std::begin(shape.indices), std::end(shape.indices),
+	                                                         std::begin(shape_copy.indices)));
+	assert(shape_copy.labels==shape.labels && to_json(shape_copy)==shape_json);
+
+	auto shape_error = std::string();
+	auto shape_handler = sf2::format::Error_handler{[&](auto& msg, auto, auto) { shape_error = msg; }};
+	sf2::deserialize_json(std::string_view{R"({"labels": ["x", "y", "z", "w", "v"], "indices": [9]})"},
+	                      shape_handler, shape_copy);
+	assert(shape_error=="Too many elements for a container of size 3");
+	assert((shape_copy.labels==sf2::static_vector<std::string, 3>{"x", "y", "z"}));
+	assert(shape_copy.indices[0]==9 && shape_copy.indices[1]==5);
+
+	shape_error.clear();
+	sf2::deserialize_json(std::string_view{R"({"position": [0, 0, 0, 1], "labels": []})"}, shape_handler, shape_copy);
+	assert(shape_error=="Too many elements for a container of size 3" && shape_copy.labels.empty());
+
+	// associative containers from sorted and unsorted input
+	auto ordered = std::map<std::string, int>{{"old", 0}};
+	auto unordered = std::unordered_map<std::string, int>{};
+	auto multi = std::multimap<std::string, int>{};
+	auto ordered_set = std::set<int>{};
+	auto unordered_set = std::unordered_set<int>{};
+	for(auto map_json : {std::string(R"({"a": 1, "b": 2, "c": 3})"), std::string(R"({"c": 3, "a": 1, "b": 2})")}) {
+		read_list(map_json, ordered);
+		read_list(map_json, unordered);
+		read_list(map_json, multi);
+		assert((ordered==std::map<std::string, int>{{"a", 1}, {"b", 2}, {"c", 3}}));
+		assert((unordered==std::unordered_map<std::string, int>{{"a", 1}, {"b", 2}, {"c", 3}}));
+		assert((multi==std::multimap<std::string, int>{{"a", 1}, {"b", 2}, {"c", 3}}));
+	}
+	read_list("[3, 1, 2, 1]", ordered_set);
+	read_list("[3, 1, 2, 1]", unordered_set);
+	assert((ordered_set==std::set<int>{1, 2, 3} && unordered_set==std::unordered_set<int>{1, 2, 3}));
+	read_list(R"({"a": 1, "a": 2})", ordered);
+	assert(ordered.size()==1);
+
+	auto v1 = 0, v2 = 0, v3 = 0;
+	sf2::deserialize_json_virtual(std::string_view{R"({"v3": 3, "v1": 1, "v2": 2})"},
+	                              sf2::vmember("v1", v1), sf2::vmember("v2", v2), sf2::vmember("v3", v3));
+	assert(v1==1 && v2==2 && v3==3);
+
+	std::cout<<"success"<<std::endl;
+}
@@ -2,6 +2,8 @@
 #include <iostream>
 #include <cassert>
 #include <sstream>
+#include <fstream>
+#include <filesystem>
 
 #include <sf2/sf2.hpp>
 
@@ -53,5 +55,32 @@ int main() {
 
 	assert(out.str()==str && "generated string doesn't match expected result");
 
+	Player player3;
+	sf2::deserialize_json(std::string_view{str}, player3);
+
+	std::stringstream out_buffer;
+
+	sf2::serialize_json(out_buffer, player3);
+
+	assert(out_buffer.str()==str && "buffer reader result doesn't match stream reader");
+
+	auto path = std::filesystem::temp_directory_path() / "sf2_test_simple.json";
+	std::ofstream{path}<<str;
+
+	Player player4;
+	auto loaded = sf2::deserialize_json_file(path.string(), player4);
+	std::filesystem::remove(path);
+	if(!loaded) {
+		std::cerr<<"couldn't map the test file"<<std::endl;
+		return 1;
+	}
+
+	std::stringstream out_file;
+
+	sf2::serialize_json(out_file, player4);
+
+	assert(out_file.str()==str && "mapped file result doesn't match stream reader");
+	assert(!sf2::deserialize_json_file("does_not_exist.json", player4));
+
 	std::cout<<"success"<<std::endl;
 }